@@ -69,6 +69,40 @@
 // Any edge on E latches data while RW is '0'.
 //
 //
+// Wide Address Cycle Catalogue (addrSize > dataSize):
+// ---------------------------------------------------
+//                Set Wide Address + WR Data
+//
+// rw             _______________________________
+//                   ___________________________
+// e              __/                           \__
+//                          _________
+// ddr            _________/         \___________
+//                  ____________ _______ _____
+// data[7:0] C   -<____High____X__Low__X_Data>--
+//                         :         :        :
+// addrHigh       _________X_________________
+//                ___:_______________X___________
+// address        ___X_______________X___________
+//                                            :
+// dataIn[7:0]    ____________________________X__
+//                                               _
+// wr_data        ______________________________/ \_
+//
+// While E is '1' and RW is '0' a rising edge on DDR latches the high address
+// byte, a falling edge latches the low address byte and combines both. The
+// rising edge of E already latched the high byte as address, this gets
+// replaced before data arrives. The C never changes DDR while E is '1'
+// otherwise, so this does not interfere with the other cycles. A plain
+// address strobe addresses the lowest 256 locations.
+//
+// With addrSize < dataSize the upper bits of the address byte get ignored,
+// the registers repeat every 2**addrSize addresses. The demo with 34
+// registers uses 6 bits, so e.g. 0x00, 0x40, 0x80 and 0xC0 address the same
+// register. Wide addresses get cut to addrSize bits the same way, with
+// addrSize > 2 * dataSize they get zero extended.
+//
+//
 // Basic Cyle Combinations:
 // ------------------------
 //                   Register WR          Register RD        Register RD + WR
@@ -225,17 +259,49 @@ module ucif
 
 
    reg         e_old = 0;
+   reg         ddr_old = 0;
+
+   reg   [(dataSize-1):0]  addrHigh = 0;
+
+   wire  [(2*dataSize-1):0]  wideIn = {addrHigh, dataIn};
+   wire  [(addrSize-1):0]    plainAddr;
+   wire  [(addrSize-1):0]    wideAddr;
+
+
+   // Fit both address forms to addrSize, cut off or zero extended.
+   generate
+      if (addrSize > dataSize)
+         assign plainAddr = {{(addrSize-dataSize){1'b0}}, dataIn};
+      else
+         assign plainAddr = dataIn[(addrSize-1):0];
+
+      if (addrSize > 2*dataSize)
+         assign wideAddr = {{(addrSize-2*dataSize){1'b0}}, wideIn};
+      else
+         assign wideAddr = wideIn[(addrSize-1):0];
+   endgenerate
 
 
    // For the edge detection
    always @(posedge clock)
+   begin
       e_old <= e;
+      ddr_old <= ddr;
+   end
+
+
+   // High byte of a wide address
+   always @(posedge clock)
+      if (e & ddr & ~ddr_old & ~rw)
+         addrHigh <= dataIn;
 
 
    // Set address
    always @(posedge clock)
       if (e & ~e_old & ~rw & ~ddr)
-         address <= dataIn[(addrSize-1):0];
+         address <= plainAddr;
+      else if (e & ~ddr & ddr_old & ~rw)
+         address <= wideAddr;
 
 
    // WR data
@@ -104,11 +104,13 @@
    #define  UCIF_E_PORT       PORTD /**< \~English Port register of UCIF-E line \~German Portregister fr UCIF-E Signal */
    #define  UCIF_E_DIR        DDRD  /**< \~English Port direction of UCIF-E line \~German Richtungsregister fr UCIF-E Signal */
    #define  UCIF_E_LINE       3     /**< \~English Port line of UCIF-E line \~German Portleitung fr UCIF-E Signal */
+   #define  UCIF_E_TOGGLE     PIND  /**< \~English Input register of UCIF-E line, writing '1' toggles \~German Eingaberegister fr UCIF-E Signal, Schreiben von '1' schaltet um */
 
    #define  UCIF_RW_PORT      PORTD /**< \~English Port register of UCIF-RW line \~German Portregister fr UCIF-RW Signal */
 // #define  UCIF_RW_RET       PIND  /**< \~English Port register of UCIF-RW readback \~German Portregister fr UCIF-RW Rcklesung */
    #define  UCIF_RW_DIR       DDRD  /**< \~English Port direction of UCIF-RW line \~German Richtungsregister fr UCIF-RW Signal */
    #define  UCIF_RW_LINE      2     /**< \~English Port line of UCIF-RW line \~German Portleitung fr UCIF-RW Signal */
+   #define  UCIF_RW_TOGGLE    PIND  /**< \~English Input register of UCIF-RW line, writing '1' toggles \~German Eingaberegister fr UCIF-RW Signal, Schreiben von '1' schaltet um */
 
    #define  UCIF_DDR_PORT     PORTD /**< \~English Port register of UCIF-DDR line \~German Portregister fr UCIF-DDR Signal */
    #define  UCIF_DDR_DIR      DDRD  /**< \~English Port direction of UCIF-DDR line \~German Richtungsregister fr UCIF-DDR Signal */
@@ -200,12 +202,32 @@
     */
 
 
+   #define UNIQUE_SERIAL_NUMBER
+   /**<
+    * \~English
+    *  lets the device report the unique ID from the signature row of the
+    *  ATmega32U4 as its serial number, 20 hexadecimal digits. LUFA creates
+    *  the string descriptor at runtime. Every board gets its own serial, so
+    *  the host can tell several boards apart (e. g. /dev/serial/by-id).
+    *  Comment it out to report DEVICE_SERIAL_NUMBER instead.
+    * \~German
+    *  lsst das Gert die eindeutige ID aus der Signaturzeile des ATmega32U4
+    *  als Seriennummer melden, 20 hexadezimale Ziffern. LUFA erzeugt den
+    *  String-Deskriptor zur Laufzeit. Jede Platine erhlt ihre eigene
+    *  Seriennummer, so kann der Host mehrere Platinen unterscheiden (z. B.
+    *  /dev/serial/by-id).
+    *  Auskommentiert wird stattdessen DEVICE_SERIAL_NUMBER gemeldet.
+    */
+
+
    #define DEVICE_SERIAL_NUMBER           L"01"
    /**<
     * \~English
-    *  The device serial number. The default value is "01".
+    *  The device serial number if UNIQUE_SERIAL_NUMBER is not defined. The
+    *  default value is "01".
     * \~German
-    *  Die Seriennummer des Gertes. Der Startwert ist "01".
+    *  Die Seriennummer des Gertes, falls UNIQUE_SERIAL_NUMBER nicht
+    *  definiert ist. Der Startwert ist "01".
     */
 
 
@@ -230,4 +252,235 @@
     */
 
 
+   // USB device functions:
+
+// #define DUAL_CDC
+   /**<
+    * \~English
+    *  turns the device into a composite device with two CDC ACM functions.
+    *  The first one (interfaces 0 and 1) is the binary data channel to the
+    *  UCIF, the second one (interfaces 2 and 3) is a permanent console for
+    *  configuration and status commands. The console stays available while
+    *  the application interface is running.
+    *  Comment it out to get the single CDC function that switches between
+    *  command line and application interface.
+    *  @note The two functions occupy all six endpoints of the ATmega32U4.
+    * \~German
+    *  macht das Gert zu einem Verbundgert mit zwei CDC-ACM-Funktionen.
+    *  Die erste (Interfaces 0 und 1) ist der binre Datenkanal zum UCIF,
+    *  die zweite (Interfaces 2 und 3) eine stndig verfgbare Konsole fr
+    *  Konfigurations- und Statuskommandos. Die Konsole bleibt auch whrend
+    *  der Anwendungsschnittstelle erreichbar.
+    *  Auskommentiert bleibt es bei der einzelnen CDC-Funktion, die zwischen
+    *  Kommandozeile und Anwendungsschnittstelle umschaltet.
+    *  @note Die beiden Funktionen belegen alle sechs Endpunkte des
+    *  ATmega32U4.
+    */
+
+
+// #define HID_LINK
+   /**<
+    * \~English
+    *  adds a vendor defined HID interface (interface 2) to the data CDC
+    *  function. It carries small SDR-RD and SDR-WR transactions in 64 byte
+    *  reports. The interrupt IN endpoint is polled every 1 ms, so a register
+    *  access gets a bounded round-trip time even on a busy host where the
+    *  bulk transfers of the CDC are scheduled on a best-effort basis.
+    *  Requests travel as SET_REPORT via the control endpoint, the answers
+    *  via the interrupt IN endpoint.
+    *  @note Can not be combined with DUAL_CDC, there are not enough
+    *  endpoints left.
+    * \~German
+    *  ergnzt die CDC-Funktion des Datenkanals um eine herstellerspezifische
+    *  HID-Schnittstelle (Interface 2). Sie bertrgt kleine SDR-RD und SDR-WR
+    *  Zugriffe in Reports von 64 Byte. Der Interrupt-IN-Endpunkt wird jede
+    *  Millisekunde abgefragt. Ein Registerzugriff hat so eine begrenzte
+    *  Umlaufzeit, selbst wenn der Host stark beschftigt ist und die
+    *  Bulk-Transfers des CDC nur nachrangig bedient.
+    *  Anfragen kommen als SET_REPORT ber den Kontrollendpunkt, die
+    *  Antworten gehen ber den Interrupt-IN-Endpunkt.
+    *  @note Nicht mit DUAL_CDC kombinierbar, dafr reichen die Endpunkte
+    *  nicht aus.
+    */
+
+
+// #define MSC_DRIVE
+   /**<
+    * \~English
+    *  adds a mass storage interface presenting the SPI-FLASH as a small FAT12
+    *  drive. The bitstream stored shows up as the read-only file CURRENT.BIT.
+    *  A .bit file copied to the drive replaces it and configures the FPGA
+    *  as soon as it is stored completely. The host block layer drives the
+    *  transfer, no terminal program is needed.
+    *  @note Can not be combined with DUAL_CDC, there are not enough
+    *  endpoints left.
+    * \~German
+    *  ergnzt eine Massenspeicher-Schnittstelle, die das SPI-FLASH als
+    *  kleines FAT12-Laufwerk darstellt. Der gespeicherte Bitstream erscheint
+    *  als schreibgeschtzte Datei CURRENT.BIT. Eine auf das Laufwerk kopierte
+    *  .bit-Datei ersetzt ihn und konfiguriert das FPGA, sobald sie
+    *  vollstndig gespeichert ist. Der Host steuert die bertragung selbst,
+    *  ein Terminalprogramm ist nicht notwendig.
+    *  @note Nicht mit DUAL_CDC kombinierbar, dafr reichen die Endpunkte
+    *  nicht aus.
+    */
+
+
+   #if defined(DUAL_CDC) && defined(HID_LINK)
+      #error "DUAL_CDC and HID_LINK exceed the endpoints of the ATmega32U4, select just one of them."
+   #endif
+
+   #if defined(DUAL_CDC) && defined(MSC_DRIVE)
+      #error "DUAL_CDC and MSC_DRIVE exceed the endpoints of the ATmega32U4, select just one of them."
+   #endif
+
+
+   // Application link properties:
+
+   #define FLUSH_TIMEOUT_MS               1  // Milliseconds, 0 = flush on every loop pass
+   /**<
+    * \~English
+    *  defines the default flush policy of the application loop.
+    *  Responses get collected in the IN endpoint until it is filled up to
+    *  CDC_TXRX_EPSIZE, the request burst has been processed completely or
+    *  this many USB frames (SOF events, 1 ms each) have passed since the
+    *  last flush. A value of 0 sends any data at the end of each loop pass.
+    *  The host can change the policy per session by the option packet.
+    * \~German
+    *  legt die voreingestellte Strategie fr das Absenden der Antworten
+    *  in der Anwendungsschleife fest. Antworten werden im IN-Endpunkt
+    *  gesammelt bis dieser mit CDC_TXRX_EPSIZE Bytes gefllt ist, alle
+    *  anstehenden Anfragen abgearbeitet sind oder seit dem letzten Absenden
+    *  so viele USB-Frames (SOF-Ereignisse zu je 1 ms) vergangen sind.
+    *  Der Wert 0 sendet alle Daten am Ende jedes Schleifendurchlaufs.
+    *  Der Host kann die Einstellung je Sitzung mit dem Options-Paket ndern.
+    */
+
+   #define WORK_BUFFER_SIZE            1024  // Bytes
+   /**<
+    * \~English
+    *  defines the size of the buffer shared by the console (bitstream
+    *  transfers), the capture packet 'C' and the benchmark, it is the
+    *  largest piece of static RAM. The size must be even and at least 256.
+    *  Estimated static RAM of the ATmega32U4 (2560 bytes) without it: about
+    *  190 bytes for the default build, DUAL_CDC adds about 20, HID_LINK
+    *  about 140, MSC_DRIVE about 90 and SHADOW_SIZE 64 about 80 bytes. The
+    *  stack takes up to about 400 bytes. With 1024 bytes the build with
+    *  HID_LINK, MSC_DRIVE and SHADOW_SIZE still keeps about 600 bytes spare.
+    *  Larger sizes give longer capture windows, check the RAM left then.
+    * \~German
+    *  legt die Gre des Puffers fest, den sich die Konsole
+    *  (Bitstream-bertragungen), das Aufzeichnungspaket 'C' und der
+    *  Geschwindigkeitstest teilen, er ist der grte Teil des statischen
+    *  RAM. Die Gre muss gerade und mindestens 256 sein. Geschtzter
+    *  statischer RAM-Bedarf des ATmega32U4 (2560 Bytes) ohne ihn: etwa
+    *  190 Bytes fr die Grundeinstellung, DUAL_CDC kommt mit etwa 20 dazu,
+    *  HID_LINK mit etwa 140, MSC_DRIVE mit etwa 90 und SHADOW_SIZE 64 mit
+    *  etwa 80 Bytes. Der Stack belegt bis zu etwa 400 Bytes. Mit 1024 Bytes
+    *  bleiben auch mit HID_LINK, MSC_DRIVE und SHADOW_SIZE etwa 600 Bytes
+    *  frei. Grere Werte verlngern das Aufzeichnungsfenster, dann den
+    *  verbleibenden RAM prfen.
+    */
+
+   #if (WORK_BUFFER_SIZE < 256) || (WORK_BUFFER_SIZE % 2)
+      #error "WORK_BUFFER_SIZE must be even and at least 256."
+   #endif
+
+// #define AUTORUN_MACRO                  0  // Slot number
+   /**<
+    * \~English
+    *  runs the EEPROM macro of the given slot right after each successful
+    *  FPGA configuration, e.g. to set up the registers of the design. The
+    *  host records the macro with the packet 'M'.
+    *  Comment it out to leave the registers of the FPGA untouched.
+    * \~German
+    *  fhrt das EEPROM-Makro des angegebenen Platzes direkt nach jeder
+    *  erfolgreichen FPGA-Konfiguration aus, z.B. um die Register des
+    *  Designs einzurichten. Der Host zeichnet das Makro mit dem Paket 'M'
+    *  auf.
+    *  Auskommentiert bleiben die Register des FPGA unberhrt.
+    */
+
+// #define SHADOW_SIZE                   64  // Registers
+   #define SHADOW_BASE                    0  // First register
+   /**<
+    * \~English
+    *  keeps shadow copies of the registers SHADOW_BASE ... SHADOW_BASE +
+    *  SHADOW_SIZE - 1 in RAM, this takes about 1.25 bytes per register.
+    *  Registers declared static by the session option 'D' get answered
+    *  from the shadow on SDR-RD, SDR-WR packets not changing them get
+    *  dropped.
+    *  Comment out SHADOW_SIZE to access all registers on the UCIF.
+    * \~German
+    *  hlt Schattenkopien der Register SHADOW_BASE ... SHADOW_BASE +
+    *  SHADOW_SIZE - 1 im RAM, das belegt etwa 1,25 Bytes je Register. Mit
+    *  der Sitzungsoption 'D' als statisch erklrte Register werden bei
+    *  SDR-RD aus dem Schatten beantwortet, SDR-WR-Pakete, die sie nicht
+    *  ndern, werden verworfen.
+    *  Ist SHADOW_SIZE auskommentiert, erfolgen alle Registerzugriffe ber
+    *  das UCIF.
+    */
+
+// #define ATTENTION_EVENTS
+   /**<
+    * \~English
+    *  turns the spare pin PE6 into an attention input of the FPGA. A falling
+    *  edge triggers INT6, the application loop then reads the status
+    *  registers chosen by the session options 'E' and 'N' and sends them
+    *  to the host as an event packet '!'. The FPGA drives the line low to
+    *  signal, the weak pullup keeps it high otherwise.
+    *  Comment it out to leave PE6 unused.
+    * \~German
+    *  macht den freien Pin PE6 zu einem Aufmerksamkeitseingang des FPGA.
+    *  Eine fallende Flanke lst INT6 aus, die Anwendungsschleife liest dann
+    *  die mit den Sitzungsoptionen 'E' und 'N' gewhlten Statusregister und
+    *  sendet sie als Ereignispaket '!' zum Host. Das FPGA zieht die Leitung
+    *  zum Melden auf low, der schwache Pullup hlt sie sonst auf high.
+    *  Auskommentiert bleibt PE6 unbenutzt.
+    */
+
+
+   // Diagnostics:
+
+// #define STARTUP_TIMING
+   /**<
+    * \~English
+    *  measures the startup of the device with Timer1, beginning at the
+    *  entry of main(). Time stamps get taken when USB_Init() returns, when
+    *  the host selects the configuration and when the first CDC byte from
+    *  the host arrives. The console command 't' reports them in ms with a
+    *  resolution of 0.128 ms, the range ends after about 8.4 s. Timer1 gets
+    *  stopped after the last time stamp. The time spent before main(), in
+    *  the bootloader and the C runtime startup, is not covered.
+    *  Comment it out to keep Timer1 untouched.
+    * \~German
+    *  misst den Start des Gertes mit Timer1, beginnend mit dem Eintritt in
+    *  main(). Zeitstempel werden genommen, wenn USB_Init() zurckkehrt, wenn
+    *  der Host die Konfiguration auswhlt und wenn das erste CDC-Byte vom
+    *  Host eintrifft. Das Konsolenkommando 't' gibt sie in ms mit einer
+    *  Auflsung von 0,128 ms aus, der Messbereich endet nach etwa 8,4 s.
+    *  Timer1 wird nach dem letzten Zeitstempel angehalten. Die Zeit vor
+    *  main(), im Bootloader und beim Start der C-Laufzeitumgebung, wird
+    *  nicht erfasst.
+    *  Auskommentiert bleibt Timer1 unberhrt.
+    */
+
+
+// #define UCIF_BENCHMARK
+   /**<
+    * \~English
+    *  adds the console command 'b', which runs each UCIF burst kernel for
+    *  255 words with Timer1 counting CPU cycles and reports the bus bytes
+    *  per second. Address and data bytes are 0, so the benchmark writes 0
+    *  to register 0 of the FPGA design.
+    *  Comment it out to save the code.
+    * \~German
+    *  fgt das Konsolenkommando 'b' hinzu, das jeden UCIF-Burst-Kern fr 255
+    *  Worte ausfhrt, whrend Timer1 die CPU-Takte zhlt, und die Busbytes
+    *  pro Sekunde ausgibt. Adress- und Datenbytes sind 0, der Test schreibt
+    *  also 0 in das Register 0 des FPGA-Designs.
+    *  Auskommentiert wird der Code eingespart.
+    */
+
+
 #endif
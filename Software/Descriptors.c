@@ -53,9 +53,15 @@ const USB_Descriptor_Device_t PROGMEM DeviceDescriptor =
    .Header                 = {.Size = sizeof(USB_Descriptor_Device_t), .Type = DTYPE_Device},
 
    .USBSpecification       = VERSION_BCD(1,1,0),
+#if defined(COMPOSITE_DEVICE)
+   .Class                  = USB_CSCP_IADDeviceClass,       // 0xEF  'Miscellaneous'
+   .SubClass               = USB_CSCP_IADDeviceSubclass,    // 0x02  'Common Class'
+   .Protocol               = USB_CSCP_IADDeviceProtocol,    // 0x01  'Interface Association'
+#else
    .Class                  = CDC_CSCP_CDCClass,
    .SubClass               = CDC_CSCP_NoSpecificSubclass,   // 0x00  'None'
    .Protocol               = CDC_CSCP_NoSpecificProtocol,   // 0x00  'None'
+#endif
 
    .Endpoint0Size          = FIXED_CONTROL_ENDPOINT_SIZE,   // ./Config/LUFAConfig.h
 
@@ -69,7 +75,11 @@ const USB_Descriptor_Device_t PROGMEM DeviceDescriptor =
 
    .ManufacturerStrIndex   = STRING_ID_Manufacturer,        // 0x01 ./Descriptors.h
    .ProductStrIndex        = STRING_ID_Product,             // 0x02 ./Descriptors.h
+#if defined(UNIQUE_SERIAL_NUMBER)
+   .SerialNumStrIndex      = USE_INTERNAL_SERIAL,           // 0xDC handled by LUFA
+#else
    .SerialNumStrIndex      = STRING_ID_SerialNo,            // 0x03 ./Descriptors.h
+#endif
 
    .NumberOfConfigurations = FIXED_NUM_CONFIGURATIONS       // ./Config/LUFAConfig.h
 };
@@ -97,6 +107,28 @@ const USB_Descriptor_Device_t PROGMEM DeviceDescriptor =
  */
 
 
+#if defined(HID_LINK)
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM HIDReport[] =
+{
+   HID_DESCRIPTOR_VENDOR(0x00, 0x01, 0x02, 0x03, HID_REPORT_SIZE)
+};
+/**<
+ * \~ HID Report Descriptor.
+ *
+ * \~English
+ *  Vendor defined report of HID_REPORT_SIZE bytes for both directions,
+ *  without a report ID. The content is not interpreted by the host, it
+ *  carries the register access packets of the HID_LINK.
+ *
+ * \~German
+ *  Herstellerspezifischer Report mit HID_REPORT_SIZE Bytes für beide
+ *  Richtungen, ohne Report-ID. Der Host interpretiert den Inhalt nicht,
+ *  er transportiert die Registerzugriffe des HID_LINK.
+ *  Der Deskriptor liegt im FLASH des Controllers.
+ */
+#endif
+
+
 const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor =
 {
    .Config =
@@ -104,7 +136,7 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor =
          .Header                 = {.Size = sizeof(USB_Descriptor_Configuration_Header_t), .Type = DTYPE_Configuration},
 
          .TotalConfigurationSize = sizeof(USB_Descriptor_Configuration_t),
-         .TotalInterfaces        = 2,
+         .TotalInterfaces        = INTERFACE_COUNT, // ./Descriptors.h
 
          .ConfigurationNumber    = 1,
          .ConfigurationStrIndex  = NO_DESCRIPTOR,
@@ -114,6 +146,22 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor =
          .MaxPowerConsumption    = USB_CONFIG_POWER_MA(MAX_CURRENT_DRAW) // ./Config/AppConfig.h
       },
 
+#if defined(COMPOSITE_DEVICE)
+   .CDC_IAD =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Interface_Association_t), .Type = DTYPE_InterfaceAssociation},
+
+         .FirstInterfaceIndex    = INTERFACE_ID_CDC_CCI,
+         .TotalInterfaces        = 2,
+
+         .Class                  = CDC_CSCP_CDCClass,
+         .SubClass               = CDC_CSCP_ACMSubclass,
+         .Protocol               = CDC_CSCP_ATCommandProtocol,
+
+         .IADStrIndex            = NO_DESCRIPTOR
+      },
+#endif
+
    .CDC_CCI_Interface =
       {
          .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
@@ -206,7 +254,187 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor =
          .Attributes             = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
          .EndpointSize           = CDC_TXRX_EPSIZE, // ./Descriptors.h
          .PollingIntervalMS      = POLLING_INTERVAL // ./Config/AppConfig.h
-      }
+      },
+
+#if defined(DUAL_CDC)
+   .Console_IAD =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Interface_Association_t), .Type = DTYPE_InterfaceAssociation},
+
+         .FirstInterfaceIndex    = INTERFACE_ID_CONSOLE_CCI,
+         .TotalInterfaces        = 2,
+
+         .Class                  = CDC_CSCP_CDCClass,
+         .SubClass               = CDC_CSCP_ACMSubclass,
+         .Protocol               = CDC_CSCP_ATCommandProtocol,
+
+         .IADStrIndex            = NO_DESCRIPTOR
+      },
+
+   .Console_CCI_Interface =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+         .InterfaceNumber        = INTERFACE_ID_CONSOLE_CCI,
+         .AlternateSetting       = 0,
+
+         .TotalEndpoints         = 1,
+
+         .Class                  = CDC_CSCP_CDCClass,
+         .SubClass               = CDC_CSCP_ACMSubclass,
+         .Protocol               = CDC_CSCP_ATCommandProtocol,
+
+         .InterfaceStrIndex      = NO_DESCRIPTOR
+      },
+
+   .Console_Functional_Header =
+      {
+         .Header                 = {.Size = sizeof(USB_CDC_Descriptor_FunctionalHeader_t), .Type = DTYPE_CSInterface},
+         .Subtype                = CDC_DSUBTYPE_CSInterface_Header,
+
+         .CDCSpecification       = VERSION_BCD(1,1,0),
+      },
+
+   .Console_Functional_ACM =
+      {
+         .Header                 = {.Size = sizeof(USB_CDC_Descriptor_FunctionalACM_t), .Type = DTYPE_CSInterface},
+         .Subtype                = CDC_DSUBTYPE_CSInterface_ACM,
+
+         .Capabilities           = 0x06, // same as the data channel
+      },
+
+   .Console_Functional_Union =
+      {
+         .Header                 = {.Size = sizeof(USB_CDC_Descriptor_FunctionalUnion_t), .Type = DTYPE_CSInterface},
+         .Subtype                = CDC_DSUBTYPE_CSInterface_Union,
+
+         .MasterInterfaceNumber  = INTERFACE_ID_CONSOLE_CCI,
+         .SlaveInterfaceNumber   = INTERFACE_ID_CONSOLE_DCI,
+      },
+
+   .Console_NotificationEndpoint =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+         .EndpointAddress        = CONSOLE_NOTIFICATION_EPADDR,
+         .Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+         .EndpointSize           = CDC_NOTIFICATION_EPSIZE, // ./Descriptors.h
+         .PollingIntervalMS      = 0xFF
+      },
+
+   .Console_DCI_Interface =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+         .InterfaceNumber        = INTERFACE_ID_CONSOLE_DCI,
+         .AlternateSetting       = 0,
+
+         .TotalEndpoints         = 2,
+
+         .Class                  = CDC_CSCP_CDCDataClass,
+         .SubClass               = CDC_CSCP_NoDataSubclass,
+         .Protocol               = CDC_CSCP_NoDataProtocol,
+
+         .InterfaceStrIndex      = NO_DESCRIPTOR
+      },
+
+   .Console_DataOutEndpoint =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+         .EndpointAddress        = CONSOLE_RX_EPADDR,
+         .Attributes             = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+         .EndpointSize           = CDC_TXRX_EPSIZE, // ./Descriptors.h
+         .PollingIntervalMS      = POLLING_INTERVAL // ./Config/AppConfig.h
+      },
+
+   .Console_DataInEndpoint =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+         .EndpointAddress        = CONSOLE_TX_EPADDR,
+         .Attributes             = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+         .EndpointSize           = CDC_TXRX_EPSIZE, // ./Descriptors.h
+         .PollingIntervalMS      = POLLING_INTERVAL // ./Config/AppConfig.h
+      },
+#endif
+
+#if defined(HID_LINK)
+   .HID_Interface =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+         .InterfaceNumber        = INTERFACE_ID_HID,
+         .AlternateSetting       = 0,
+
+         .TotalEndpoints         = 1,
+
+         .Class                  = HID_CSCP_HIDClass,
+         .SubClass               = HID_CSCP_NonBootSubclass,
+         .Protocol               = HID_CSCP_NonBootProtocol,
+
+         .InterfaceStrIndex      = NO_DESCRIPTOR
+      },
+
+   .HID_GenericHID =
+      {
+         .Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t), .Type = HID_DTYPE_HID},
+
+         .HIDSpec                = VERSION_BCD(1,1,1),
+         .CountryCode            = 0x00,
+         .TotalReportDescriptors = 1,
+         .HIDReportType          = HID_DTYPE_Report,
+         .HIDReportLength        = sizeof(HIDReport)
+      },
+
+   .HID_ReportINEndpoint =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+         .EndpointAddress        = HID_IN_EPADDR,
+         .Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+         .EndpointSize           = HID_REPORT_SIZE,     // ./Descriptors.h
+         .PollingIntervalMS      = HID_POLLING_INTERVAL // ./Descriptors.h
+      },
+#endif
+
+#if defined(MSC_DRIVE)
+   .MSC_Interface =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+         .InterfaceNumber        = INTERFACE_ID_MSC,
+         .AlternateSetting       = 0,
+
+         .TotalEndpoints         = 2,
+
+         .Class                  = MS_CSCP_MassStorageClass,
+         .SubClass               = MS_CSCP_SCSITransparentSubclass,
+         .Protocol               = MS_CSCP_BulkOnlyTransportProtocol,
+
+         .InterfaceStrIndex      = NO_DESCRIPTOR
+      },
+
+   .MSC_DataInEndpoint =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+         .EndpointAddress        = MSC_IN_EPADDR,
+         .Attributes             = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+         .EndpointSize           = MSC_IO_EPSIZE,   // ./Descriptors.h
+         .PollingIntervalMS      = POLLING_INTERVAL // ./Config/AppConfig.h
+      },
+
+   .MSC_DataOutEndpoint =
+      {
+         .Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+         .EndpointAddress        = MSC_OUT_EPADDR,
+         .Attributes             = (EP_TYPE_BULK | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+         .EndpointSize           = MSC_IO_EPSIZE,   // ./Descriptors.h
+         .PollingIntervalMS      = POLLING_INTERVAL // ./Config/AppConfig.h
+      },
+#endif
 };
 /**<
  * \~ Configuration Descriptor structure.
@@ -292,6 +520,7 @@ const USB_Descriptor_String_t PROGMEM ProductString = USB_STRING_DESCRIPTOR(PROD
  */
 
 
+#if !defined(UNIQUE_SERIAL_NUMBER)
 const USB_Descriptor_String_t PROGMEM SerialString = USB_STRING_DESCRIPTOR(DEVICE_SERIAL_NUMBER);
 // ./Config/AppConfig.h
 /**<
@@ -310,6 +539,7 @@ const USB_Descriptor_String_t PROGMEM SerialString = USB_STRING_DESCRIPTOR(DEVIC
  *  Die zugehörige String-ID ist im Device Deskriptor abgelegt.
  *  Der Text liegt im FLASH des Controllers.
  */
+#endif
 
 
 uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
@@ -347,12 +577,24 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
                Address = &ProductString;
                Size    = pgm_read_byte(&ProductString.Header.Size);
                break;
+#if !defined(UNIQUE_SERIAL_NUMBER)
             case STRING_ID_SerialNo:
                Address = &SerialString;
                Size    = pgm_read_byte(&SerialString.Header.Size);
                break;
+#endif
          }
          break;
+#if defined(HID_LINK)
+      case HID_DTYPE_HID:
+         Address = &ConfigurationDescriptor.HID_GenericHID;
+         Size    = sizeof(USB_HID_Descriptor_HID_t);
+         break;
+      case HID_DTYPE_Report:
+         Address = &HIDReport;
+         Size    = sizeof(HIDReport);
+         break;
+#endif
    }
    *DescriptorAddress = Address;
    return Size;
@@ -44,6 +44,10 @@
    #include <LUFA/Drivers/USB/USB.h>
    #include "Config/AppConfig.h"
 
+   #if defined(UNIQUE_SERIAL_NUMBER) && defined(NO_INTERNAL_SERIAL)
+      #error "UNIQUE_SERIAL_NUMBER needs the internal serial of LUFA, do not define NO_INTERNAL_SERIAL."
+   #endif
+
 
    // Macros:
 
@@ -62,6 +66,44 @@
    /** Size in bytes of the CDC data IN and OUT endpoints. */
    #define CDC_TXRX_EPSIZE                64 // max. 128 or needs 2 banks?
 
+   #if defined(DUAL_CDC)
+      /** Endpoint address of the console device-to-host notification IN endpoint. */
+      #define CONSOLE_NOTIFICATION_EPADDR (ENDPOINT_DIR_IN  | 1)
+
+      /** Endpoint address of the console device-to-host data IN endpoint. */
+      #define CONSOLE_TX_EPADDR           (ENDPOINT_DIR_IN  | 5)
+
+      /** Endpoint address of the console host-to-device data OUT endpoint. */
+      #define CONSOLE_RX_EPADDR           (ENDPOINT_DIR_OUT | 6)
+   #endif
+
+   #if defined(HID_LINK)
+      /** Endpoint address of the HID device-to-host report IN endpoint. */
+      #define HID_IN_EPADDR               (ENDPOINT_DIR_IN  | 1)
+
+      /** Size in bytes of the HID reports and the HID report IN endpoint. */
+      #define HID_REPORT_SIZE             64
+
+      /** Polling interval of the HID report IN endpoint in milliseconds. */
+      #define HID_POLLING_INTERVAL        1
+   #endif
+
+   #if defined(MSC_DRIVE)
+      /** Endpoint address of the mass storage device-to-host data IN endpoint. */
+      #define MSC_IN_EPADDR               (ENDPOINT_DIR_IN  | 5)
+
+      /** Endpoint address of the mass storage host-to-device data OUT endpoint. */
+      #define MSC_OUT_EPADDR              (ENDPOINT_DIR_OUT | 6)
+
+      /** Size in bytes of the mass storage data IN and OUT endpoints. */
+      #define MSC_IO_EPSIZE               64
+   #endif
+
+   #if defined(DUAL_CDC) || defined(HID_LINK) || defined(MSC_DRIVE)
+      /** The device consists of several functions, tied by association descriptors. */
+      #define COMPOSITE_DEVICE
+   #endif
+
 
    // Type Defines:
 
@@ -82,6 +124,11 @@
    {
       USB_Descriptor_Configuration_Header_t    Config;
 
+   #if defined(COMPOSITE_DEVICE)
+      // CDC Data Channel Association
+      USB_Descriptor_Interface_Association_t   CDC_IAD;
+   #endif
+
       // CDC Control Interface
       USB_Descriptor_Interface_t               CDC_CCI_Interface;
       USB_CDC_Descriptor_FunctionalHeader_t    CDC_Functional_Header;
@@ -93,6 +140,37 @@
       USB_Descriptor_Interface_t               CDC_DCI_Interface;
       USB_Descriptor_Endpoint_t                CDC_DataOutEndpoint;
       USB_Descriptor_Endpoint_t                CDC_DataInEndpoint;
+
+   #if defined(DUAL_CDC)
+      // Console Association
+      USB_Descriptor_Interface_Association_t   Console_IAD;
+
+      // Console Control Interface
+      USB_Descriptor_Interface_t               Console_CCI_Interface;
+      USB_CDC_Descriptor_FunctionalHeader_t    Console_Functional_Header;
+      USB_CDC_Descriptor_FunctionalACM_t       Console_Functional_ACM;
+      USB_CDC_Descriptor_FunctionalUnion_t     Console_Functional_Union;
+      USB_Descriptor_Endpoint_t                Console_NotificationEndpoint;
+
+      // Console Data Interface
+      USB_Descriptor_Interface_t               Console_DCI_Interface;
+      USB_Descriptor_Endpoint_t                Console_DataOutEndpoint;
+      USB_Descriptor_Endpoint_t                Console_DataInEndpoint;
+   #endif
+
+   #if defined(HID_LINK)
+      // Register Access HID Interface
+      USB_Descriptor_Interface_t               HID_Interface;
+      USB_HID_Descriptor_HID_t                 HID_GenericHID;
+      USB_Descriptor_Endpoint_t                HID_ReportINEndpoint;
+   #endif
+
+   #if defined(MSC_DRIVE)
+      // Configuration FLASH Mass Storage Interface
+      USB_Descriptor_Interface_t               MSC_Interface;
+      USB_Descriptor_Endpoint_t                MSC_DataInEndpoint;
+      USB_Descriptor_Endpoint_t                MSC_DataOutEndpoint;
+   #endif
    } USB_Descriptor_Configuration_t;
 
 
@@ -112,6 +190,17 @@
    {
       INTERFACE_ID_CDC_CCI = 0, /**< CDC CCI interface descriptor ID */
       INTERFACE_ID_CDC_DCI = 1, /**< CDC DCI interface descriptor ID */
+   #if defined(DUAL_CDC)
+      INTERFACE_ID_CONSOLE_CCI = 2, /**< Console CCI interface descriptor ID */
+      INTERFACE_ID_CONSOLE_DCI = 3, /**< Console DCI interface descriptor ID */
+   #endif
+   #if defined(HID_LINK)
+      INTERFACE_ID_HID = 2, /**< Register access HID interface descriptor ID */
+   #endif
+   #if defined(MSC_DRIVE)
+      INTERFACE_ID_MSC, /**< Configuration FLASH mass storage interface descriptor ID, follows the HID if present */
+   #endif
+      INTERFACE_COUNT /**< Count of interfaces, keep it the last entry */
    };
 
 
@@ -0,0 +1,162 @@
+/*
+   * Spartan Configurator *
+
+   Copyright 2021  René Trapp (rene [dot] trapp (-at-) web [dot] de)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file
+ *  \~English
+ *   @brief Implements the EEPROM macros.
+ *
+ *   Slot layout: byte 0 holds the size of the body, the body follows. An
+ *   erased EEPROM reads 0xFF, which is no valid size and counts as empty.
+ *
+ *  \~German
+ *   @brief Implementiert die EEPROM-Makros.
+ *
+ *   Aufbau eines Platzes: Byte 0 enthält die Größe des Inhalts, danach
+ *   folgt der Inhalt. Ein gelöschtes EEPROM liest sich als 0xFF, was keine
+ *   gültige Größe ist und als leer gilt.
+ */
+
+
+#include <avr/io.h>
+#include <avr/eeprom.h>
+
+#include "Ucif/ucif.h"
+#include "./macro.h"
+
+
+static uint8_t EEMEM macroStore[MACRO_SLOTS][MACRO_SLOT_SIZE];    /**< \~English Macro slots. \~German Makroplätze. */
+
+static uint8_t recSlot;    /**< \~English Slot being recorded. \~German Aufgezeichneter Platz. */
+static uint8_t recSize;    /**< \~English Body bytes recorded so far. \~German Bisher aufgezeichnete Bytes des Inhalts. */
+
+
+uint8_t macroReady(void)
+{
+   return(eeprom_is_ready());
+}
+
+
+void macroBegin(const uint8_t slot)
+{
+   recSlot = slot;
+   recSize = 0;
+   eeprom_update_byte(&macroStore[slot][0], 0);
+}
+
+
+void macroAppend(const uint8_t data)
+{
+   if (recSize < MACRO_BODY_MAX)
+   {
+      recSize++;
+      eeprom_update_byte(&macroStore[recSlot][recSize], data);
+   }
+}
+
+
+void macroEnd(void)
+{
+   eeprom_update_byte(&macroStore[recSlot][0], recSize);
+}
+
+
+void macroRun(const uint8_t slot)
+{
+   if (slot >= MACRO_SLOTS)
+      return;
+
+   const uint8_t *body = &macroStore[slot][1];
+   uint8_t size = eeprom_read_byte(&macroStore[slot][0]);
+   uint8_t pos = 0;
+
+   if (size == 0xFF)
+      return;
+   while ((size - pos) >= 2)
+   {
+      uint8_t id = eeprom_read_byte(&body[pos++]);
+      uint8_t count = eeprom_read_byte(&body[pos++]);
+
+      switch (id)
+      {
+         case 'w':   // SDR-WR packet
+         case 'W':   // DDR-WR packet
+            if (id == 'w')
+               UCIF_DDR_CLR;
+            else
+               UCIF_DDR_SET;
+            UCIF_RW_CLR;
+            UCIF_AS_OUTPUT;
+            while ((count-- > 0) && ((size - pos) >= 2))
+            {
+               UCIF_DATA_PORT = eeprom_read_byte(&body[pos++]);
+               UCIF_E_SET;
+               UCIF_DATA_PORT = eeprom_read_byte(&body[pos++]);
+               UCIF_E_CLR;
+            }
+            break;
+         case 'b':   // Burst write packet
+            if (size == pos)
+               return;
+            {
+               uint8_t address = eeprom_read_byte(&body[pos++]);
+
+               UCIF_DDR_CLR;
+               UCIF_RW_CLR;
+               UCIF_AS_OUTPUT;
+               while ((count-- > 0) && (size > pos))
+               {
+                  UCIF_DATA_PORT = address++;
+                  UCIF_E_SET;
+                  UCIF_DATA_PORT = eeprom_read_byte(&body[pos++]);
+                  UCIF_E_CLR;
+               }
+            }
+            break;
+         case 'h':   // Wide address SDR-WR packet
+            while ((count-- > 0) && ((size - pos) >= 3))
+            {
+               uint16_t address = (uint16_t)eeprom_read_byte(&body[pos++]) << 8;
+
+               address |= eeprom_read_byte(&body[pos++]);
+               ucifWideWrite(address, eeprom_read_byte(&body[pos++]));
+            }
+            break;
+         case UCIF_OP_MASKED:
+         case UCIF_OP_SET:
+         case UCIF_OP_CLEAR:
+         case UCIF_OP_TOGGLE:
+            {
+               uint8_t entry = (id == UCIF_OP_MASKED) ? 3 : 2;
+
+               while ((count-- > 0) && ((size - pos) >= entry))
+               {
+                  uint8_t address = eeprom_read_byte(&body[pos++]);
+                  uint8_t mask = eeprom_read_byte(&body[pos++]);
+                  uint8_t value = (entry == 3) ? eeprom_read_byte(&body[pos++]) : 0;
+
+                  ucifModify(id, address, mask, value);
+               }
+            }
+            break;
+         default:
+            return;
+      }
+   }
+}
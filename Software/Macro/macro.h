@@ -0,0 +1,124 @@
+/*
+   * Spartan Configurator *
+
+   Copyright 2021  René Trapp (rene [dot] trapp (-at-) web [dot] de)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file
+ *  \~English
+ *   @brief Stores sequences of UCIF write packets in the EEPROM and
+ *   replays them.
+ *
+ *   A macro body consists of the packets 'w', 'W', 'b', 'h', 'm', 's', 'c'
+ *   and 't' with the same layout as sent by the host. Running a macro performs
+ *   the accesses without any USB transfer in between and without answers.
+ *
+ *  \~German
+ *   @brief Speichert Folgen von UCIF-Schreibpaketen im EEPROM und spielt
+ *   sie ab.
+ *
+ *   Ein Makro besteht aus den Paketen 'w', 'W', 'b', 'h', 'm', 's', 'c'
+ *   und 't' im selben Aufbau, wie sie der Host sendet. Das Ausführen eines Makros
+ *   erledigt die Zugriffe ohne USB-Übertragung dazwischen und ohne
+ *   Antworten.
+ */
+
+
+#ifndef __MACRO_H__
+   #define __MACRO_H__
+
+
+   // Includes:
+
+   #include <avr/io.h>
+
+
+   // Definitions:
+
+   #define  MACRO_SLOTS       4     /**< \~English Count of macros, 4 slots fill the EEPROM of the ATmega32U4. \~German Anzahl der Makros, 4 Plätze füllen das EEPROM des ATmega32U4. */
+   #define  MACRO_SLOT_SIZE   256   /**< \~English Bytes per slot: the body size and the body. \~German Bytes pro Platz: Die Größe des Inhalts und der Inhalt. */
+   #define  MACRO_BODY_MAX    254   /**< \~English Body bytes per slot at most, a size of 255 = 0xFF marks an empty slot. \~German Höchstens Bytes Inhalt pro Platz, eine Größe von 255 = 0xFF kennzeichnet einen leeren Platz. */
+
+
+   // Function Prototypes:
+
+   uint8_t macroReady(void);
+   /**<
+    * \~English
+    *  Tells whether the EEPROM can accept the next byte. The recording
+    *  functions must not get called before.
+    *  @return !'0' (true) if the previous EEPROM write is done.
+    *
+    * \~German
+    *  Meldet, ob das EEPROM das nächste Byte annehmen kann. Die
+    *  Aufzeichnungsfunktionen dürfen erst danach aufgerufen werden.
+    *  @return !'0' (true) wenn der vorige EEPROM-Schreibvorgang erledigt
+    *  ist.
+    */
+
+
+   void macroBegin(const uint8_t slot);
+   /**<
+    * \~English
+    *  Starts recording the macro 'slot'. The slot reads as empty until
+    *  macroEnd() gets called.
+    *
+    * \~German
+    *  Beginnt die Aufzeichnung des Makros 'slot'. Der Platz gilt als leer,
+    *  bis macroEnd() aufgerufen wird.
+    */
+
+
+   void macroAppend(const uint8_t data);
+   /**<
+    * \~English
+    *  Stores the next byte of the macro body. Bytes beyond MACRO_BODY_MAX
+    *  get dropped.
+    *
+    * \~German
+    *  Speichert das nächste Byte des Makroinhalts. Bytes jenseits von
+    *  MACRO_BODY_MAX werden verworfen.
+    */
+
+
+   void macroEnd(void);
+   /**<
+    * \~English
+    *  Completes the recording by storing the size of the body.
+    *
+    * \~German
+    *  Schließt die Aufzeichnung ab, indem die Größe des Inhalts gespeichert
+    *  wird.
+    */
+
+
+   void macroRun(const uint8_t slot);
+   /**<
+    * \~English
+    *  Performs the packets of macro 'slot'. An unknown packet ID ends the
+    *  macro, a packet reaching beyond the body gets cut off. Empty slots
+    *  and slot numbers out of range do nothing.
+    *
+    * \~German
+    *  Führt die Pakete des Makros 'slot' aus. Eine unbekannte Paket-ID
+    *  beendet das Makro, ein über den Inhalt hinausreichendes Paket wird
+    *  abgeschnitten. Leere Plätze und ungültige Platznummern bewirken
+    *  nichts.
+    */
+
+
+#endif
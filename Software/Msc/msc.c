@@ -0,0 +1,486 @@
+/*
+   * Spartan Configurator *
+
+   Copyright 2021  René Trapp (rene [dot] trapp (-at-) web [dot] de)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file
+ *  \~English
+ *   @brief Implements the FAT12 drive view of the SPI-FLASH.
+ *
+ *   Volume layout, one sector per cluster:
+ *   - LBA 0: boot sector
+ *   - 2 FATs of FAT_SECTORS each
+ *   - 1 sector root directory (volume label and CURRENT.BIT)
+ *   - data area of twice the FLASH size, CURRENT.BIT starts at its
+ *     beginning. The spare half leaves room for a new file copied to the
+ *     drive while CURRENT.BIT still exists.
+ *
+ *   Writes to boot sector, FATs and root directory are accepted but
+ *   discarded, the host keeps them in its cache. Writes to the data area
+ *   are examined: the first cluster of a new file starting with a Xilinx
+ *   bitstream header erases the FLASH and marks the start of the new file.
+ *   A new file starts at the first cluster of the data area or right
+ *   behind CURRENT.BIT. The following sectors are stored relative to it
+ *   until they cover the size given by the header without a gap.
+ *
+ *  \~German
+ *   @brief Implementiert die Darstellung des SPI-FLASH als FAT12-Laufwerk.
+ *
+ *   Aufbau des Laufwerks, ein Sektor pro Cluster:
+ *   - LBA 0: Bootsektor
+ *   - 2 FATs mit je FAT_SECTORS
+ *   - 1 Sektor Wurzelverzeichnis (Laufwerksname und CURRENT.BIT)
+ *   - Datenbereich mit der doppelten Größe des FLASH, CURRENT.BIT beginnt
+ *     an seinem Anfang. Die zweite Hälfte bietet Platz für eine neue Datei,
+ *     die auf das Laufwerk kopiert wird während CURRENT.BIT noch existiert.
+ *
+ *   Schreibzugriffe auf Bootsektor, FATs und Wurzelverzeichnis werden
+ *   angenommen aber verworfen, der Host hält sie in seinem Cache.
+ *   Schreibzugriffe auf den Datenbereich werden untersucht: Der erste
+ *   Cluster einer neuen Datei, der mit dem Kopfteil eines Xilinx-Bitstreams
+ *   beginnt, löscht das FLASH und markiert den Anfang der neuen Datei. Eine
+ *   neue Datei beginnt im ersten Cluster des Datenbereichs oder direkt
+ *   hinter CURRENT.BIT. Die folgenden Sektoren werden relativ dazu
+ *   gespeichert, bis sie die im Kopfteil angegebene Größe lückenlos
+ *   abdecken.
+ */
+
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+#include <LUFA/Drivers/USB/USB.h>
+
+#include "Config/AppConfig.h"
+#include "Fpga/fpga.h"
+#include "SPI-flash/flash.h"
+#include "./msc.h"
+
+
+#if defined(MSC_DRIVE)
+
+#define  SECTOR_SIZE        512                              /**< \~English Bytes per sector. \~German Bytes pro Sektor. */
+#define  CHUNK_SIZE          32                              /**< \~English Bytes moved per step, divides SECTOR_SIZE. \~German Pro Schritt übertragene Bytes, teilt SECTOR_SIZE. */
+#define  FAT_SECTORS          8                              /**< \~English Sectors per FAT. \~German Sektoren pro FAT. */
+#define  FAT1_LBA             1                              /**< \~English First sector of FAT 1. \~German Erster Sektor der FAT 1. */
+#define  ROOT_LBA            (FAT1_LBA + 2 * FAT_SECTORS)    /**< \~English Sector of the root directory. \~German Sektor des Wurzelverzeichnisses. */
+#define  ROOT_ENTRIES        (SECTOR_SIZE / 32)              /**< \~English Count of root directory entries. \~German Anzahl der Einträge im Wurzelverzeichnis. */
+#define  DATA_LBA            (ROOT_LBA + 1)                  /**< \~English First sector of the data area. \~German Erster Sektor des Datenbereichs. */
+#define  DATA_SECTORS        (2 * FLASH_SIZE / SECTOR_SIZE)  /**< \~English Sectors of the data area. \~German Sektoren des Datenbereichs. */
+#define  TOTAL_SECTORS       (DATA_LBA + DATA_SECTORS)       /**< \~English Sectors of the drive. \~German Sektoren des Laufwerks. */
+#define  FIRST_CLUSTER        2                              /**< \~English Cluster number of the first data sector. \~German Clusternummer des ersten Datensektors. */
+
+#define  PREAMBLE_SIZE       13                              /**< \~English Bytes of the bitstream preamble ahead of field 'a'. \~German Bytes der Bitstream-Präambel vor dem Feld 'a'. */
+
+
+/**
+ *  \~English
+ *   Boot sector start. The remainder is 0 except for the signature.
+ *
+ *  \~German
+ *   Anfang des Bootsektors. Der Rest ist 0 bis auf die Signatur.
+ */
+static const uint8_t PROGMEM bootSector[] =
+{
+   0xEB, 0x3C, 0x90,                                  // jump to (no) boot code
+   'M', 'O', 'J', 'O', ' ', 'O', 'S', ' ',            // OEM name
+   (SECTOR_SIZE & 0xFF), (SECTOR_SIZE >> 8),          // bytes per sector
+   1,                                                 // sectors per cluster
+   1, 0,                                              // reserved sectors
+   2,                                                 // count of FATs
+   ROOT_ENTRIES, 0,                                   // root directory entries
+   (TOTAL_SECTORS & 0xFF), (TOTAL_SECTORS >> 8),      // sectors of the drive
+   0xF8,                                              // media: fixed disk
+   FAT_SECTORS, 0,                                    // sectors per FAT
+   32, 0,                                             // sectors per track
+   64, 0,                                             // heads
+   0, 0, 0, 0,                                        // hidden sectors
+   0, 0, 0, 0,                                        // sectors, 32 bit
+   0x80, 0, 0x29,                                     // drive, reserved, extended boot signature
+   0x21, 0x20, 0x4F, 0x4D,                            // volume serial number
+   'M', 'O', 'J', 'O', ' ', 'F', 'L', 'A', 'S', 'H', ' ',   // volume label
+   'F', 'A', 'T', '1', '2', ' ', ' ', ' '             // file system type
+};
+
+
+static const uint8_t PROGMEM volumeLabel[11] = {'M', 'O', 'J', 'O', ' ', 'F', 'L', 'A', 'S', 'H', ' '};  /**< \~English Directory entry name of the volume label. \~German Verzeichnisname des Laufwerksnamens. */
+static const uint8_t PROGMEM fileName[11]    = {'C', 'U', 'R', 'R', 'E', 'N', 'T', ' ', 'B', 'I', 'T'};  /**< \~English Directory entry name of the bitstream. \~German Verzeichnisname des Bitstreams. */
+
+
+/**
+ *  \~English
+ *   Answer to the SCSI INQUIRY command.
+ *
+ *  \~German
+ *   Antwort auf das SCSI-Kommando INQUIRY.
+ */
+static const SCSI_Inquiry_Response_t PROGMEM inquiryData =
+{
+   .DeviceType          = 0x00,  // direct access block device
+   .PeripheralQualifier = 0,
+   .Removable           = true,
+   .Version             = 0,
+   .ResponseDataFormat  = 2,
+   .AdditionalLength    = 0x1F,
+   .VendorID            = "Mojo OS ",
+   .ProductID           = "Config FLASH    ",
+   .RevisionID          = {'0' + RELEASE_MAJOR, '.', '0' + RELEASE_MINOR, '0' + RELEASE_REVISION},
+};
+
+
+/**
+ *  \~English
+ *   Answer to the SCSI REQUEST SENSE command, tells the reason of the last
+ *   failed command.
+ *
+ *  \~German
+ *   Antwort auf das SCSI-Kommando REQUEST SENSE, gibt den Grund für das
+ *   zuletzt fehlgeschlagene Kommando an.
+ */
+static SCSI_Request_Sense_Response_t senseData =
+{
+   .ResponseCode        = 0x70,
+   .AdditionalLength    = 0x0A,
+};
+
+
+static uint32_t volumeFileSize = 0;    /**< \~English Size of CURRENT.BIT, 0 = no file. \~German Größe von CURRENT.BIT, 0 = keine Datei. */
+static uint16_t volumeClusters = 0;    /**< \~English Clusters occupied by CURRENT.BIT. \~German Von CURRENT.BIT belegte Cluster. */
+static uint8_t  mediumChanged = 0;     /**< \~English !'0' to report a changed medium to the host. \~German !'0' um dem Host ein geändertes Medium zu melden. */
+static uint8_t  newBitstream = 0;      /**< \~English !'0' when a copied bitstream is stored completely. \~German !'0' wenn ein kopierter Bitstream vollständig gespeichert ist. */
+static uint8_t  storing = 0;           /**< \~English !'0' while a copied bitstream gets stored. \~German !'0' solange ein kopierter Bitstream gespeichert wird. */
+static uint32_t storeLBA = 0;          /**< \~English Sector holding the start of the copied bitstream. \~German Sektor mit dem Anfang des kopierten Bitstreams. */
+static uint32_t storeSize = 0;         /**< \~English Size of the copied bitstream, 0 = not yet known. \~German Größe des kopierten Bitstreams, 0 = noch unbekannt. */
+static uint32_t storeCount = 0;        /**< \~English Bytes of the copied bitstream stored without a gap from its start. \~German Ab seinem Anfang lückenlos gespeicherte Bytes des kopierten Bitstreams. */
+
+
+uint32_t storedBitstreamSize(void)
+{
+   uint8_t  buffer[16];
+   uint32_t addr = PREAMBLE_SIZE;
+
+   readFlash(buffer, 0, sizeof(buffer));
+   if (XilinxGetHeaderField(buffer, XILINX_FIELD_DESIGN) == 0)
+      return(0);
+
+   // Walk the fields 'a' to 'e' without a buffer for the entire header.
+   for (uint8_t field = XILINX_FIELD_DESIGN; field <= XILINX_FIELD_DATA; field++)
+   {
+      readFlash(buffer, addr, 1 + XILINX_SIZE_OF_SIZE);
+      if (buffer[0] != field)
+         return(0);
+      if (field == XILINX_FIELD_DATA)
+      {
+         addr += 1 + XILINX_SIZE_OF_SIZE + XilinxExtractBitstreamSize(&buffer[1]);
+         return((addr <= FLASH_SIZE) ? addr : 0);
+      }
+      addr += 3 + (((uint16_t)buffer[1] << 8) | buffer[2]);
+   }
+   return(0);
+}
+
+
+void mscScanFlash(void)
+{
+   volumeFileSize = storedBitstreamSize();
+   volumeClusters = (volumeFileSize + SECTOR_SIZE - 1) / SECTOR_SIZE;
+   mediumChanged = 1;
+}
+
+
+uint8_t mscNewBitstream(void)
+{
+   uint8_t retVal = newBitstream;
+
+   newBitstream = 0;
+   return(retVal);
+}
+
+
+uint16_t fatEntry(uint16_t cluster)
+{
+   if (cluster < FIRST_CLUSTER)
+      return((cluster == 0) ? 0xFF8 : 0xFFF);   // media, end of chain
+   if (cluster >= (FIRST_CLUSTER + volumeClusters))
+      return(0);                                // free
+   if (cluster == (FIRST_CLUSTER + volumeClusters - 1))
+      return(0xFFF);                            // last one of CURRENT.BIT
+   return(cluster + 1);                         // CURRENT.BIT is contiguous
+}
+
+
+uint8_t fatByte(uint16_t pos)
+{
+   // FAT12 packs two entries into three bytes.
+   uint16_t cluster = (pos / 3) * 2;
+
+   switch (pos % 3)
+   {
+      case 0:
+         return(fatEntry(cluster));
+      case 1:
+         return((fatEntry(cluster) >> 8) | (fatEntry(cluster + 1) << 4));
+      default:
+         return(fatEntry(cluster + 1) >> 4);
+   }
+}
+
+
+uint8_t dirByte(uint16_t pos)
+{
+   uint8_t field = pos % 32;
+
+   switch (pos / 32)
+   {
+      case 0:  // volume label
+         if (field < sizeof(volumeLabel))
+            return(pgm_read_byte(&volumeLabel[field]));
+         if (field == 11)
+            return(0x08);  // attribute: volume label
+         break;
+      case 1:  // bitstream file
+         if (volumeFileSize == 0)
+            break;
+         if (field < sizeof(fileName))
+            return(pgm_read_byte(&fileName[field]));
+         switch (field)
+         {
+            case 11: return(0x01);  // attribute: read-only
+            case 24: return(0x21);  // date of last write: 1980-01-01
+            case 26: return(FIRST_CLUSTER);
+            case 28: return(volumeFileSize);
+            case 29: return(volumeFileSize >> 8);
+            case 30: return(volumeFileSize >> 16);
+            case 31: return(volumeFileSize >> 24);
+            default: ;
+         }
+         break;
+      default:
+         ;
+   }
+   return(0);
+}
+
+
+void readChunk(uint32_t lba, uint16_t ofs, uint8_t* chunk)
+{
+   memset(chunk, 0, CHUNK_SIZE);
+   if (lba == 0)
+   {
+      for (uint8_t n = 0; n < CHUNK_SIZE; n++)
+      {
+         uint16_t pos = ofs + n;
+         if (pos < sizeof(bootSector))
+            chunk[n] = pgm_read_byte(&bootSector[pos]);
+         else if (pos == 510)
+            chunk[n] = 0x55;
+         else if (pos == 511)
+            chunk[n] = 0xAA;
+      }
+   }
+   else if (lba < ROOT_LBA)
+   {
+      uint16_t pos = ((lba - FAT1_LBA) % FAT_SECTORS) * SECTOR_SIZE + ofs;
+      for (uint8_t n = 0; n < CHUNK_SIZE; n++)
+         chunk[n] = fatByte(pos + n);
+   }
+   else if (lba == ROOT_LBA)
+   {
+      for (uint8_t n = 0; n < CHUNK_SIZE; n++)
+         chunk[n] = dirByte(ofs + n);
+   }
+   else
+   {
+      uint32_t addr = (lba - DATA_LBA) * SECTOR_SIZE + ofs;
+      if (addr < volumeFileSize)
+         readFlash(chunk, addr, CHUNK_SIZE);
+   }
+}
+
+
+void writeChunk(uint32_t lba, uint16_t ofs, uint8_t* chunk)
+{
+   if (lba < DATA_LBA)
+      return;  // boot sector, FAT and directory live in the host cache only
+
+   // Bitstreams embedded in other files must not erase the FLASH, just the
+   // first cluster of a new file counts. A copy started over writes it again.
+   if ((ofs == 0) &&
+       ((lba == DATA_LBA) || (lba == (DATA_LBA + volumeClusters)) ||
+        (storing && (lba == storeLBA))) &&
+       (XilinxGetHeaderField(chunk, XILINX_FIELD_DESIGN) != 0))
+   {
+      // A new bitstream arrives, the old one gets lost now.
+      eraseFlash();
+      volumeFileSize = 0;
+      volumeClusters = 0;
+      storeLBA = lba;
+      storeSize = 0;
+      storeCount = 0;
+      storing = 1;
+   }
+
+   if (!storing || (lba < storeLBA))
+      return;
+
+   uint32_t addr = (lba - storeLBA) * SECTOR_SIZE + ofs;
+   if (addr >= FLASH_SIZE)
+      return;
+   writeFlash(chunk, addr, CHUNK_SIZE);
+   // Sectors written again or ahead of a gap do not extend the file.
+   if (addr != storeCount)
+      return;
+   storeCount += CHUNK_SIZE;
+
+   if (storeSize == 0)
+      storeSize = storedBitstreamSize();  // as soon as the header is stored
+   if ((storeSize != 0) && (storeCount >= storeSize))
+   {
+      storing = 0;
+      mscScanFlash();
+      newBitstream = 1;
+   }
+}
+
+
+void setSense(uint8_t key, uint8_t code, uint8_t qualifier)
+{
+   senseData.SenseKey = key;
+   senseData.AdditionalSenseCode = code;
+   senseData.AdditionalSenseQualifier = qualifier;
+}
+
+
+bool scsiTransferBlocks(USB_ClassInfo_MS_Device_t* const MSInterfaceInfo, uint8_t isRead)
+{
+   uint8_t* cmd = MSInterfaceInfo->State.CommandBlock.SCSICommandData;
+   uint32_t lba = ((uint32_t)cmd[2] << 24) | ((uint32_t)cmd[3] << 16) | ((uint16_t)cmd[4] << 8) | cmd[5];
+   uint16_t blocks = ((uint16_t)cmd[7] << 8) | cmd[8];
+   uint8_t  chunk[CHUNK_SIZE];
+
+   if ((lba + blocks) > TOTAL_SECTORS)
+   {
+      setSense(SCSI_SENSE_KEY_ILLEGAL_REQUEST, SCSI_ASENSE_LOGICAL_BLOCK_ADDRESS_OUT_OF_RANGE, SCSI_ASENSEQ_NO_QUALIFIER);
+      return(false);
+   }
+
+   for (uint16_t b = blocks; b > 0; b--, lba++)
+   {
+      for (uint16_t ofs = 0; ofs < SECTOR_SIZE; ofs += CHUNK_SIZE)
+      {
+         if (isRead)
+         {
+            readChunk(lba, ofs, chunk);
+            if (Endpoint_Write_Stream_LE(chunk, CHUNK_SIZE, NULL) != ENDPOINT_RWSTREAM_NoError)
+               return(false);
+         }
+         else
+         {
+            if (Endpoint_Read_Stream_LE(chunk, CHUNK_SIZE, NULL) != ENDPOINT_RWSTREAM_NoError)
+               return(false);
+            writeChunk(lba, ofs, chunk);
+         }
+         if (MSInterfaceInfo->State.IsMassStoreReset)
+            return(false);
+      }
+   }
+
+   // The streams leave the last bank pending.
+   if (blocks > 0)
+   {
+      if (isRead)
+         Endpoint_ClearIN();
+      else
+         Endpoint_ClearOUT();
+   }
+   MSInterfaceInfo->State.CommandBlock.DataTransferLength -= (uint32_t)blocks * SECTOR_SIZE;
+   return(true);
+}
+
+
+bool CALLBACK_MS_Device_SCSICommandReceived(USB_ClassInfo_MS_Device_t* const MSInterfaceInfo)
+{
+   uint8_t* cmd = MSInterfaceInfo->State.CommandBlock.SCSICommandData;
+   bool     success = true;
+
+   switch (cmd[0])
+   {
+      case SCSI_CMD_INQUIRY:
+         {
+            uint16_t allocated = ((uint16_t)cmd[3] << 8) | cmd[4];
+            uint16_t bytes = (allocated < sizeof(inquiryData)) ? allocated : sizeof(inquiryData);
+            Endpoint_Write_PStream_LE(&inquiryData, bytes, NULL);
+            Endpoint_Null_Stream(allocated - bytes, NULL);
+            Endpoint_ClearIN();
+            MSInterfaceInfo->State.CommandBlock.DataTransferLength -= bytes;
+         }
+         break;
+      case SCSI_CMD_REQUEST_SENSE:
+         {
+            uint8_t bytes = (cmd[4] < sizeof(senseData)) ? cmd[4] : sizeof(senseData);
+            Endpoint_Write_Stream_LE(&senseData, bytes, NULL);
+            Endpoint_Null_Stream(cmd[4] - bytes, NULL);
+            Endpoint_ClearIN();
+            MSInterfaceInfo->State.CommandBlock.DataTransferLength -= bytes;
+         }
+         break;
+      case SCSI_CMD_READ_CAPACITY_10:
+         Endpoint_Write_32_BE(TOTAL_SECTORS - 1);
+         Endpoint_Write_32_BE(SECTOR_SIZE);
+         Endpoint_ClearIN();
+         MSInterfaceInfo->State.CommandBlock.DataTransferLength -= 8;
+         break;
+      case SCSI_CMD_MODE_SENSE_6:
+         Endpoint_Write_8(0x03);    // mode data length
+         Endpoint_Write_8(0x00);    // medium type
+         Endpoint_Write_8(0x00);    // not write protected
+         Endpoint_Write_8(0x00);    // no block descriptors
+         Endpoint_ClearIN();
+         MSInterfaceInfo->State.CommandBlock.DataTransferLength -= 4;
+         break;
+      case SCSI_CMD_READ_10:
+         success = scsiTransferBlocks(MSInterfaceInfo, 1);
+         break;
+      case SCSI_CMD_WRITE_10:
+         success = scsiTransferBlocks(MSInterfaceInfo, 0);
+         break;
+      case SCSI_CMD_TEST_UNIT_READY:
+         if (mediumChanged)
+         {
+            mediumChanged = 0;
+            setSense(SCSI_SENSE_KEY_UNIT_ATTENTION, SCSI_ASENSE_NOT_READY_TO_READY_CHANGE, SCSI_ASENSEQ_NO_QUALIFIER);
+            return(false);
+         }
+         // There is intentionally no `break;` here!
+      case SCSI_CMD_SEND_DIAGNOSTIC:
+      case SCSI_CMD_START_STOP_UNIT:
+      case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
+      case SCSI_CMD_VERIFY_10:
+         MSInterfaceInfo->State.CommandBlock.DataTransferLength = 0;
+         break;
+      default:
+         setSense(SCSI_SENSE_KEY_ILLEGAL_REQUEST, SCSI_ASENSE_INVALID_COMMAND, SCSI_ASENSEQ_NO_QUALIFIER);
+         return(false);
+   }
+
+   if (success)
+      setSense(SCSI_SENSE_KEY_GOOD, SCSI_ASENSE_NO_ADDITIONAL_INFORMATION, SCSI_ASENSEQ_NO_QUALIFIER);
+   return(success);
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+   * Spartan Configurator *
+
+   Copyright 2021  René Trapp (rene [dot] trapp (-at-) web [dot] de)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file
+ *  \~English
+ *   @brief Presents the SPI-FLASH as a small FAT12 drive.
+ *
+ *   The drive is synthesized on the fly, there is no file system stored
+ *   inside the FLASH. The bitstream stored shows up as the read-only file
+ *   CURRENT.BIT. A .bit file copied to the drive is detected by its header
+ *   and written to the FLASH sector by sector.
+ *
+ *  \~German
+ *   @brief Stellt das SPI-FLASH als kleines FAT12-Laufwerk dar.
+ *
+ *   Das Laufwerk wird fortlaufend nachgebildet, im FLASH ist kein
+ *   Dateisystem gespeichert. Der gespeicherte Bitstream erscheint als
+ *   schreibgeschützte Datei CURRENT.BIT. Eine auf das Laufwerk kopierte
+ *   .bit-Datei wird an ihrem Kopfteil erkannt und Sektor für Sektor ins
+ *   FLASH geschrieben.
+ */
+
+
+#ifndef __MSC_H__
+   #define __MSC_H__
+
+
+   // Includes:
+
+   #include <avr/io.h>
+   #include "Descriptors.h"
+
+
+   // Function Prototypes:
+
+   void mscScanFlash(void);
+   /**<
+    * \~English
+    *  Determines the size of the bitstream stored in the FLASH, this is the
+    *  size of the file CURRENT.BIT. Needs to get called at startup and after
+    *  any FLASH change not done via the drive. The host gets informed about
+    *  the changed medium by its next request.
+    *
+    * \~German
+    *  Bestimmt die Größe des im FLASH gespeicherten Bitstreams, dies ist die
+    *  Größe der Datei CURRENT.BIT. Muss beim Start und nach jeder Änderung
+    *  des FLASH aufgerufen werden, die nicht über das Laufwerk erfolgt. Der
+    *  Host erfährt mit seiner nächsten Anfrage vom geänderten Medium.
+    */
+
+
+   uint8_t mscNewBitstream(void);
+   /**<
+    * \~English
+    *  Tells once whether a bitstream copied to the drive has been stored
+    *  completely.
+    *  @return !'0' (true) if the FPGA shall get configured from FLASH now.
+    *
+    * \~German
+    *  Meldet einmalig, dass ein auf das Laufwerk kopierter Bitstream
+    *  vollständig gespeichert wurde.
+    *  @return !'0' (true) wenn das FPGA jetzt aus dem FLASH konfiguriert
+    *  werden soll.
+    */
+
+
+   bool CALLBACK_MS_Device_SCSICommandReceived(USB_ClassInfo_MS_Device_t* const MSInterfaceInfo);
+   /**<
+    * \~English
+    *  Mass storage class driver callback processing the SCSI command of the
+    *  host. Supports just the commands a host needs to mount, read and
+    *  write the drive.
+    *  \param[in] MSInterfaceInfo  Pointer to the mass storage class interface
+    *             configuration structure being referenced.
+    *  @return true if the command succeeded.
+    *
+    * \~German
+    *  Funktion des Mass-Storage-Klassentreibers, die das SCSI-Kommando des
+    *  Hosts verarbeitet. Es werden nur die Kommandos unterstützt, die ein
+    *  Host zum Einbinden, Lesen und Schreiben des Laufwerks benötigt.
+    *  \param[in] MSInterfaceInfo  Zeiger auf die angewählte Schnittstelle.
+    *  @return true wenn das Kommando erfolgreich war.
+    */
+
+
+#endif
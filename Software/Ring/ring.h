@@ -0,0 +1,252 @@
+/*
+   * Spartan Configurator *
+
+   Copyright 2021  René Trapp (rene [dot] trapp (-at-) web [dot] de)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file
+ *  \~English
+ *   @brief Lock-free byte ring for one producer and one consumer.
+ *
+ *   Unlike the LUFA RingBuffer_t there is no global interrupt lock. The
+ *   producer writes 'head' only, the consumer writes 'tail' only, both are
+ *   single bytes and so get read and written atomically by the AVR. The
+ *   indices run freely, the buffer size must be a power of two up to 128.
+ *   Besides the single byte access the bulk functions allow to work on
+ *   contiguous blocks right inside the buffer. All functions are inline,
+ *   they are meant for the inner loops of the application interface.
+ *
+ *  \~German
+ *   @brief Sperrfreier Byte-Ringpuffer für einen Erzeuger und einen
+ *   Verbraucher.
+ *
+ *   Anders als beim LUFA RingBuffer_t gibt es keine globale
+ *   Interruptsperre. Der Erzeuger schreibt nur 'head', der Verbraucher nur
+ *   'tail', beide sind einzelne Bytes und werden vom AVR daher atomar
+ *   gelesen und geschrieben. Die Indizes laufen frei, die Puffergröße muss
+ *   eine Zweierpotenz bis 128 sein. Neben dem Zugriff auf einzelne Bytes
+ *   erlauben die Blockfunktionen das Arbeiten auf zusammenhängenden
+ *   Abschnitten direkt im Puffer. Alle Funktionen sind inline, sie sind
+ *   für die inneren Schleifen der Anwendungsschnittstelle gedacht.
+ */
+
+
+#ifndef __RING_H__
+   #define __RING_H__
+
+
+   // Includes:
+
+   #include <stdint.h>
+
+
+   // Type Definitions:
+
+   /**
+    *  \~English
+    *   State of a ring. Access it by the functions below only.
+    *
+    *  \~German
+    *   Zustand eines Ringpuffers. Zugriff nur über die folgenden
+    *   Funktionen.
+    */
+   typedef struct
+   {
+      uint8_t           *buffer; /**< \~English Buffer memory. \~German Pufferspeicher. */
+      uint8_t           mask;    /**< \~English Buffer size - 1. \~German Puffergröße - 1. */
+      volatile uint8_t  head;    /**< \~English Free running write index, producer only. \~German Freilaufender Schreibindex, nur Erzeuger. */
+      volatile uint8_t  tail;    /**< \~English Free running read index, consumer only. \~German Freilaufender Leseindex, nur Verbraucher. */
+   } ring_t;
+
+
+   // Function Prototypes:
+
+   static inline void ringInit(ring_t *const ring, uint8_t *const buffer, const uint8_t size)
+   {
+      ring->buffer = buffer;
+      ring->mask = size - 1;
+      ring->head = 0;
+      ring->tail = 0;
+   }
+   /**<
+    * \~English
+    *  Prepares an empty ring.
+    *  \param[out] ring    Ring to set up.
+    *  \param[in]  buffer  Buffer memory of 'size' bytes.
+    *  \param[in]  size    Power of two, 128 at most.
+    *
+    * \~German
+    *  Bereitet einen leeren Ringpuffer vor.
+    *  \param[out] ring    Einzurichtender Ringpuffer.
+    *  \param[in]  buffer  Pufferspeicher mit 'size' Bytes.
+    *  \param[in]  size    Zweierpotenz, höchstens 128.
+    */
+
+
+   static inline uint8_t ringCount(const ring_t *const ring)
+   {
+      return((uint8_t)(ring->head - ring->tail));
+   }
+   /**<
+    * \~English
+    *  @return Count of bytes stored.
+    *
+    * \~German
+    *  @return Anzahl der gespeicherten Bytes.
+    */
+
+
+   static inline uint8_t ringFree(const ring_t *const ring)
+   {
+      return((uint8_t)(ring->mask + 1 - ringCount(ring)));
+   }
+   /**<
+    * \~English
+    *  @return Count of bytes that fit into the ring.
+    *
+    * \~German
+    *  @return Anzahl der Bytes, die in den Ringpuffer passen.
+    */
+
+
+   static inline void ringInsert(ring_t *const ring, const uint8_t data)
+   {
+      uint8_t head = ring->head;
+
+      ring->buffer[head & ring->mask] = data;
+      ring->head = head + 1;
+   }
+   /**<
+    * \~English
+    *  Stores one byte. The caller has to check for free space before.
+    *
+    * \~German
+    *  Speichert ein Byte. Der Aufrufer muss zuvor auf freien Platz prüfen.
+    */
+
+
+   static inline uint8_t ringRemove(ring_t *const ring)
+   {
+      uint8_t tail = ring->tail;
+      uint8_t data = ring->buffer[tail & ring->mask];
+
+      ring->tail = tail + 1;
+      return(data);
+   }
+   /**<
+    * \~English
+    *  Takes one byte. The caller has to check for stored data before.
+    *
+    * \~German
+    *  Entnimmt ein Byte. Der Aufrufer muss zuvor auf vorhandene Daten
+    *  prüfen.
+    */
+
+
+   static inline uint8_t ringPeekAt(const ring_t *const ring, const uint8_t offset)
+   {
+      return(ring->buffer[(uint8_t)(ring->tail + offset) & ring->mask]);
+   }
+   /**<
+    * \~English
+    *  Reads a byte without taking it. The caller has to check for at least
+    *  'offset' + 1 bytes stored before.
+    *  @return The byte 'offset' positions behind the oldest one.
+    *
+    * \~German
+    *  Liest ein Byte, ohne es zu entnehmen. Der Aufrufer muss zuvor prüfen,
+    *  dass mindestens 'offset' + 1 Bytes gespeichert sind.
+    *  @return Das Byte 'offset' Stellen hinter dem ältesten.
+    */
+
+
+   static inline uint8_t ringReserveContiguous(const ring_t *const ring, uint8_t **const data)
+   {
+      uint8_t head = ring->head & ring->mask;
+      uint8_t space = ringFree(ring);
+      uint8_t toEnd = ring->mask + 1 - head;
+
+      *data = &ring->buffer[head];
+      return((space < toEnd) ? space : toEnd);
+   }
+   /**<
+    * \~English
+    *  Tells where the producer may write without wrapping around.
+    *  \param[out] data  Start of the free block.
+    *  @return Size of the free block, may be less than ringFree().
+    *
+    * \~German
+    *  Gibt an, wo der Erzeuger ohne Umbruch schreiben darf.
+    *  \param[out] data  Anfang des freien Abschnitts.
+    *  @return Größe des freien Abschnitts, kann kleiner als ringFree()
+    *  sein.
+    */
+
+
+   static inline void ringInsertN(ring_t *const ring, const uint8_t count)
+   {
+      ring->head += count;
+   }
+   /**<
+    * \~English
+    *  Hands 'count' bytes written into the block of ringReserveContiguous()
+    *  over to the consumer.
+    *
+    * \~German
+    *  Übergibt 'count' in den Abschnitt von ringReserveContiguous()
+    *  geschriebene Bytes an den Verbraucher.
+    */
+
+
+   static inline uint8_t ringPeekContiguous(const ring_t *const ring, uint8_t **const data)
+   {
+      uint8_t tail = ring->tail & ring->mask;
+      uint8_t count = ringCount(ring);
+      uint8_t toEnd = ring->mask + 1 - tail;
+
+      *data = &ring->buffer[tail];
+      return((count < toEnd) ? count : toEnd);
+   }
+   /**<
+    * \~English
+    *  Tells where the consumer may read without wrapping around.
+    *  \param[out] data  Start of the stored block.
+    *  @return Size of the stored block, may be less than ringCount().
+    *
+    * \~German
+    *  Gibt an, wo der Verbraucher ohne Umbruch lesen darf.
+    *  \param[out] data  Anfang des gespeicherten Abschnitts.
+    *  @return Größe des gespeicherten Abschnitts, kann kleiner als
+    *  ringCount() sein.
+    */
+
+
+   static inline void ringConsumeN(ring_t *const ring, const uint8_t count)
+   {
+      ring->tail += count;
+   }
+   /**<
+    * \~English
+    *  Releases 'count' bytes read from the block of ringPeekContiguous().
+    *
+    * \~German
+    *  Gibt 'count' aus dem Abschnitt von ringPeekContiguous() gelesene
+    *  Bytes frei.
+    */
+
+
+#endif
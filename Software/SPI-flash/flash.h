@@ -62,6 +62,7 @@
 
 // #define  ID_ADESTO      0x1F
    #define  ID_MICROCHIP   0xBF /**< \~English chip-ID of Microchip \~German Chip-ID von Microchip */
+   #define  FLASH_SIZE     0x80000UL /**< \~English Bytes of the FLASH (4 Mbit) \~German Bytes des FLASH (4 MBit) */
 
 
    // Function Prototypes:
@@ -0,0 +1,137 @@
+/*
+   * Spartan Configurator *
+
+   Copyright 2021  René Trapp (rene [dot] trapp (-at-) web [dot] de)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file
+ *  \~English
+ *   @brief Implements the register shadow.
+ *
+ *   One byte per register holds the content, two bit maps tell which
+ *   registers are static and which contents are known.
+ *
+ *  \~German
+ *   @brief Implementiert den Registerschatten.
+ *
+ *   Ein Byte pro Register enthält den Inhalt, zwei Bitfelder geben an,
+ *   welche Register statisch und welche Inhalte bekannt sind.
+ */
+
+
+#include <avr/io.h>
+#include <string.h>
+
+#include "Config/AppConfig.h"
+#include "./shadow.h"
+
+
+#if defined(SHADOW_SIZE)
+
+static uint8_t shadowData[SHADOW_SIZE];               /**< \~English Register contents. \~German Registerinhalte. */
+static uint8_t shadowStatic[(SHADOW_SIZE + 7) / 8];   /**< \~English One bit per static register. \~German Ein Bit je statischem Register. */
+static uint8_t shadowValid[(SHADOW_SIZE + 7) / 8];    /**< \~English One bit per known content. \~German Ein Bit je bekanntem Inhalt. */
+
+
+/**
+ *  \~English
+ *   Maps 'address' into the shadow.
+ *   @return Index into 'shadowData', SHADOW_SIZE if out of range.
+ *
+ *  \~German
+ *   Bildet 'address' auf den Schatten ab.
+ *   @return Index in 'shadowData', SHADOW_SIZE wenn außerhalb des
+ *   Bereichs.
+ */
+static inline uint16_t shadowIndex(const uint8_t address)
+{
+   uint16_t index = (uint8_t)(address - SHADOW_BASE);
+
+   return((index < SHADOW_SIZE) ? index : SHADOW_SIZE);
+}
+
+
+void shadowReset(void)
+{
+   memset(shadowStatic, 0, sizeof(shadowStatic));
+   memset(shadowValid, 0, sizeof(shadowValid));
+}
+
+
+void shadowInvalidate(void)
+{
+   memset(shadowValid, 0, sizeof(shadowValid));
+}
+
+
+void shadowDeclare(const uint8_t address, const uint8_t isStatic)
+{
+   uint16_t index = shadowIndex(address);
+
+   if (index == SHADOW_SIZE)
+      return;
+   if (isStatic)
+      shadowStatic[index / 8] |= (1 << (index % 8));
+   else
+      shadowStatic[index / 8] &= ~(1 << (index % 8));
+   shadowValid[index / 8] &= ~(1 << (index % 8));
+}
+
+
+void shadowForget(const uint8_t address)
+{
+   uint16_t index = shadowIndex(address);
+
+   if (index != SHADOW_SIZE)
+      shadowValid[index / 8] &= ~(1 << (index % 8));
+}
+
+
+void shadowStore(const uint8_t address, const uint8_t data)
+{
+   uint16_t index = shadowIndex(address);
+
+   if ((index != SHADOW_SIZE) && (shadowStatic[index / 8] & (1 << (index % 8))))
+   {
+      shadowData[index] = data;
+      shadowValid[index / 8] |= (1 << (index % 8));
+   }
+}
+
+
+uint8_t shadowRead(const uint8_t address, uint8_t *const data)
+{
+   uint16_t index = shadowIndex(address);
+
+   if ((index == SHADOW_SIZE) || !(shadowValid[index / 8] & (1 << (index % 8))))
+      return(0);
+   *data = shadowData[index];
+   return(1);
+}
+
+
+uint8_t shadowWrite(const uint8_t address, const uint8_t data)
+{
+   uint8_t known;
+
+   if (shadowRead(address, &known) && (known == data))
+      return(0);
+   shadowStore(address, data);
+   return(1);
+}
+
+#endif
@@ -0,0 +1,145 @@
+/*
+   * Spartan Configurator *
+
+   Copyright 2021  René Trapp (rene [dot] trapp (-at-) web [dot] de)
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+/** @file
+ *  \~English
+ *   @brief Shadow copies of FPGA registers in MCU RAM.
+ *
+ *   The host declares registers as static when their content changes by its
+ *   own writes only, e.g. control registers. For those the shadow answers
+ *   SDR reads without an UCIF access and drops SDR writes that would not
+ *   change the content. Only the address range SHADOW_BASE ...
+ *   SHADOW_BASE + SHADOW_SIZE - 1 can be shadowed.
+ *
+ *  \~German
+ *   @brief Schattenkopien von FPGA-Registern im RAM des MCU.
+ *
+ *   Der Host erklärt Register als statisch, wenn sich ihr Inhalt nur durch
+ *   seine eigenen Schreibzugriffe ändert, z.B. Steuerregister. Für diese
+ *   beantwortet der Schatten SDR-Lesezugriffe ohne UCIF-Zugriff und
+ *   verwirft SDR-Schreibzugriffe, die den Inhalt nicht ändern würden. Nur
+ *   der Adressbereich SHADOW_BASE ... SHADOW_BASE + SHADOW_SIZE - 1 kann
+ *   gespiegelt werden.
+ */
+
+
+#ifndef __SHADOW_H__
+   #define __SHADOW_H__
+
+
+   // Includes:
+
+   #include <avr/io.h>
+   #include "Config/AppConfig.h"
+
+
+   // Function Prototypes:
+
+   void shadowReset(void);
+   /**<
+    * \~English
+    *  Forgets all declarations and contents. Needed whenever the FPGA might
+    *  have got reconfigured.
+    *
+    * \~German
+    *  Vergisst alle Erklärungen und Inhalte. Nötig, wann immer das FPGA neu
+    *  konfiguriert worden sein könnte.
+    */
+
+
+   void shadowInvalidate(void);
+   /**<
+    * \~English
+    *  Forgets all contents but keeps the declarations. Needed after writes
+    *  bypassing the shadow.
+    *
+    * \~German
+    *  Vergisst alle Inhalte, behält aber die Erklärungen. Nötig nach
+    *  Schreibzugriffen am Schatten vorbei.
+    */
+
+
+   void shadowDeclare(const uint8_t address, const uint8_t isStatic);
+   /**<
+    * \~English
+    *  Declares register 'address' as static or not. Its content is unknown
+    *  afterwards. Addresses out of the range get ignored.
+    *
+    * \~German
+    *  Erklärt das Register 'address' als statisch oder nicht. Sein Inhalt
+    *  ist danach unbekannt. Adressen außerhalb des Bereichs werden
+    *  ignoriert.
+    */
+
+
+   void shadowForget(const uint8_t address);
+   /**<
+    * \~English
+    *  Marks the content of register 'address' as unknown.
+    *
+    * \~German
+    *  Markiert den Inhalt des Registers 'address' als unbekannt.
+    */
+
+
+   void shadowStore(const uint8_t address, const uint8_t data);
+   /**<
+    * \~English
+    *  Records 'data' as content of register 'address' if it is static.
+    *  Gets called after each UCIF access to such a register.
+    *
+    * \~German
+    *  Merkt 'data' als Inhalt des Registers 'address', wenn es statisch
+    *  ist. Wird nach jedem UCIF-Zugriff auf ein solches Register
+    *  aufgerufen.
+    */
+
+
+   uint8_t shadowRead(const uint8_t address, uint8_t *const data);
+   /**<
+    * \~English
+    *  Looks up the content of register 'address'.
+    *  \param[out] data  Content, valid on success only.
+    *  @return !'0' (true) if the content is known and the UCIF access can
+    *  be skipped.
+    *
+    * \~German
+    *  Sucht den Inhalt des Registers 'address'.
+    *  \param[out] data  Inhalt, nur bei Erfolg gültig.
+    *  @return !'0' (true) wenn der Inhalt bekannt ist und der UCIF-Zugriff
+    *  entfallen kann.
+    */
+
+
+   uint8_t shadowWrite(const uint8_t address, const uint8_t data);
+   /**<
+    * \~English
+    *  Records a write of 'data' to register 'address'.
+    *  @return !'0' (true) if the UCIF access is needed, '0' if a static
+    *  register holds 'data' already.
+    *
+    * \~German
+    *  Merkt einen Schreibzugriff von 'data' auf das Register 'address'.
+    *  @return !'0' (true) wenn der UCIF-Zugriff nötig ist, '0' wenn ein
+    *  statisches Register bereits 'data' enthält.
+    */
+
+
+#endif
@@ -57,3 +57,210 @@ void ucifBaseInit(void)
    UCIF_DDR_CLR;
    UCIF_DDR_DRIVE;
 }
+
+
+uint8_t ucifRead(const uint8_t address)
+{
+   UCIF_DDR_CLR;
+   UCIF_RW_CLR;
+   UCIF_AS_OUTPUT;
+   UCIF_DATA_PORT = address;
+   UCIF_E_SET;
+   UCIF_AS_INPUT;
+   UCIF_RW_SET;
+   UCIF_E_CLR;
+   return(UCIF_DATA_RET);
+}
+
+
+void ucifAddress(const uint8_t address)
+{
+   UCIF_DDR_CLR;
+   UCIF_RW_CLR;
+   UCIF_AS_OUTPUT;
+   UCIF_DATA_PORT = address;
+   UCIF_E_SET;
+   UCIF_AS_INPUT;
+   UCIF_RW_SET;
+   UCIF_E_CLR;
+}
+
+
+void ucifWrite(const uint8_t address, const uint8_t data)
+{
+   UCIF_DDR_CLR;
+   UCIF_RW_CLR;
+   UCIF_AS_OUTPUT;
+   UCIF_DATA_PORT = address;
+   UCIF_E_SET;
+   UCIF_DATA_PORT = data;
+   UCIF_E_CLR;
+}
+
+
+uint8_t ucifWideRead(const uint16_t address)
+{
+   UCIF_DDR_CLR;
+   UCIF_RW_CLR;
+   UCIF_AS_OUTPUT;
+   UCIF_DATA_PORT = address >> 8;
+   UCIF_E_SET;
+   UCIF_DDR_SET;
+   UCIF_DATA_PORT = address & 0xFF;
+   UCIF_DDR_CLR;
+   UCIF_AS_INPUT;
+   UCIF_RW_SET;
+   UCIF_E_CLR;
+   return(UCIF_DATA_RET);
+}
+
+
+void ucifWideWrite(const uint16_t address, const uint8_t data)
+{
+   UCIF_DDR_CLR;
+   UCIF_RW_CLR;
+   UCIF_AS_OUTPUT;
+   UCIF_DATA_PORT = address >> 8;
+   UCIF_E_SET;
+   UCIF_DDR_SET;
+   UCIF_DATA_PORT = address & 0xFF;
+   UCIF_DDR_CLR;
+   UCIF_DATA_PORT = data;
+   UCIF_E_CLR;
+}
+
+
+void ucifKernelWrite(const uint8_t *data, uint8_t words)
+{
+   uint8_t toggle = (1 << UCIF_E_LINE);
+   uint8_t tmp;
+
+   if (words == 0)
+      return;
+   __asm__ __volatile__
+   (
+      "1:                              \n\t"
+      "ld    %[tmp], %a[data]+          \n\t"   // 2
+      "out   %[port], %[tmp]            \n\t"   // 1  first byte
+      "out   %[pin], %[toggle]          \n\t"   // 1  E rises
+      "ld    %[tmp], %a[data]+          \n\t"   // 2
+      "out   %[port], %[tmp]            \n\t"   // 1  second byte
+      "out   %[pin], %[toggle]          \n\t"   // 1  E falls
+      "dec   %[words]                   \n\t"   // 1
+      "brne  1b                         \n\t"   // 2
+      : [data] "+e" (data), [words] "+r" (words), [tmp] "=&r" (tmp)
+      : [port] "I" (_SFR_IO_ADDR(UCIF_DATA_PORT)), [pin] "I" (_SFR_IO_ADDR(UCIF_E_TOGGLE)),
+        [toggle] "r" (toggle)
+      : "memory"
+   );
+}
+
+
+void ucifKernelWriteFifo(volatile uint8_t *fifo, uint8_t words)
+{
+   uint8_t toggle = (1 << UCIF_E_LINE);
+   uint8_t tmp;
+
+   if (words == 0)
+      return;
+   __asm__ __volatile__
+   (
+      "1:                              \n\t"
+      "ld    %[tmp], %a[fifo]           \n\t"   // 2
+      "out   %[port], %[tmp]            \n\t"   // 1  first byte
+      "out   %[pin], %[toggle]          \n\t"   // 1  E rises
+      "ld    %[tmp], %a[fifo]           \n\t"   // 2
+      "out   %[port], %[tmp]            \n\t"   // 1  second byte
+      "out   %[pin], %[toggle]          \n\t"   // 1  E falls
+      "dec   %[words]                   \n\t"   // 1
+      "brne  1b                         \n\t"   // 2
+      : [words] "+r" (words), [tmp] "=&r" (tmp)
+      : [fifo] "e" (fifo), [port] "I" (_SFR_IO_ADDR(UCIF_DATA_PORT)),
+        [pin] "I" (_SFR_IO_ADDR(UCIF_E_TOGGLE)), [toggle] "r" (toggle)
+      : "memory"
+   );
+}
+
+
+void ucifKernelSdrRead(const uint8_t *address, uint8_t count, volatile uint8_t *fifo)
+{
+   uint8_t toggleE = (1 << UCIF_E_LINE);
+   uint8_t toggleRW = (1 << UCIF_RW_LINE);
+   uint8_t output = 0xFF;
+   uint8_t tmp;
+
+   if (count == 0)
+      return;
+   __asm__ __volatile__
+   (
+      "1:                              \n\t"
+      "ld    %[tmp], %a[address]+       \n\t"   // 2
+      "out   %[rwpin], %[toggleRW]      \n\t"   // 1  RW falls, the FPGA releases the lines
+      "out   %[port], %[tmp]            \n\t"   // 1
+      "out   %[dir], %[output]          \n\t"   // 1  address on the lines
+      "out   %[epin], %[toggleE]        \n\t"   // 1  E rises, address gets latched
+      "out   %[dir], __zero_reg__       \n\t"   // 1  lines released
+      "out   %[rwpin], %[toggleRW]      \n\t"   // 1  RW rises, the FPGA drives the lines
+      "out   %[epin], %[toggleE]        \n\t"   // 1  E falls, ignored as RW is '1'
+      "nop                              \n\t"   // 1  response time
+      "in    %[tmp], %[ret]             \n\t"   // 1
+      "st    %a[fifo], %[tmp]           \n\t"   // 2
+      "dec   %[count]                   \n\t"   // 1
+      "brne  1b                         \n\t"   // 2
+      : [address] "+e" (address), [count] "+r" (count), [tmp] "=&r" (tmp)
+      : [fifo] "e" (fifo), [port] "I" (_SFR_IO_ADDR(UCIF_DATA_PORT)),
+        [dir] "I" (_SFR_IO_ADDR(UCIF_DATA_DIR)), [ret] "I" (_SFR_IO_ADDR(UCIF_DATA_RET)),
+        [epin] "I" (_SFR_IO_ADDR(UCIF_E_TOGGLE)), [rwpin] "I" (_SFR_IO_ADDR(UCIF_RW_TOGGLE)),
+        [toggleE] "r" (toggleE), [toggleRW] "r" (toggleRW), [output] "r" (output)
+      : "memory"
+   );
+}
+
+
+void ucifKernelDdrRead(uint8_t words, volatile uint8_t *fifo)
+{
+   uint8_t toggle = (1 << UCIF_E_LINE);
+   uint8_t first;
+   uint8_t second;
+
+   if (words == 0)
+      return;
+   __asm__ __volatile__
+   (
+      "1:                              \n\t"
+      "in    %[first], %[ret]           \n\t"   // 1
+      "out   %[pin], %[toggle]          \n\t"   // 1  E rises
+      "st    %a[fifo], %[first]         \n\t"   // 2
+      "in    %[second], %[ret]          \n\t"   // 1
+      "out   %[pin], %[toggle]          \n\t"   // 1  E falls
+      "st    %a[fifo], %[second]        \n\t"   // 2
+      "dec   %[words]                   \n\t"   // 1
+      "brne  1b                         \n\t"   // 2
+      : [words] "+r" (words), [first] "=&r" (first), [second] "=&r" (second)
+      : [fifo] "e" (fifo), [ret] "I" (_SFR_IO_ADDR(UCIF_DATA_RET)),
+        [pin] "I" (_SFR_IO_ADDR(UCIF_E_TOGGLE)), [toggle] "r" (toggle)
+      : "memory"
+   );
+}
+
+
+void ucifModify(const uint8_t op, const uint8_t address, const uint8_t mask, const uint8_t value)
+{
+   uint8_t data = ucifRead(address);
+
+   switch (op)
+   {
+      case UCIF_OP_MASKED:
+         data = (data & ~mask) | (value & mask);
+         break;
+      case UCIF_OP_SET:
+         data |= mask;
+         break;
+      case UCIF_OP_CLEAR:
+         data &= ~mask;
+         break;
+      default:    // UCIF_OP_TOGGLE
+         data ^= mask;
+   }
+   ucifWrite(address, data);
+}
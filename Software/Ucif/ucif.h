@@ -56,6 +56,11 @@
    #define  UCIF_AS_INPUT     (UCIF_DATA_DIR = 0)                          /**< \~English The data port gets input. \~German Macht die Datenleitungen zu Eingängen. */
    #define  UCIF_AS_OUTPUT    (UCIF_DATA_DIR = 0xFF)                       /**< \~English The data port gets output. \~German Macht die Datenleitungen zu Ausgängen. */
 
+   #define  UCIF_OP_MASKED    'm'                                          /**< \~English Masked write. \~German Maskiertes Schreiben. */
+   #define  UCIF_OP_SET       's'                                          /**< \~English Set bits. \~German Bits setzen. */
+   #define  UCIF_OP_CLEAR     'c'                                          /**< \~English Clear bits. \~German Bits löschen. */
+   #define  UCIF_OP_TOGGLE    't'                                          /**< \~English Toggle bits. \~German Bits umschalten. */
+
 
    // Function Prototypes:
 
@@ -67,4 +72,175 @@
     */
 
 
+   uint8_t ucifRead(const uint8_t address);
+   /**<
+    * \~English
+    *  Performs a single SDR read access.
+    *  @return The content of register 'address'.
+    *
+    * \~German
+    *  Führt einen einzelnen SDR-Lesezugriff aus.
+    *  @return Den Inhalt des Registers 'address'.
+    */
+
+
+   void ucifAddress(const uint8_t address);
+   /**<
+    * \~English
+    *  Latches 'address' without a data cycle. This is the cycle of a read,
+    *  the data driven by the FPGA gets ignored. DDR accesses following
+    *  later use this address.
+    *
+    * \~German
+    *  Setzt die Adresse 'address' ohne Datenzyklus. Das ist der Zyklus eines
+    *  Lesezugriffs, die vom FPGA gelieferten Daten werden ignoriert. Spätere
+    *  DDR-Zugriffe benutzen diese Adresse.
+    */
+
+
+   void ucifWrite(const uint8_t address, const uint8_t data);
+   /**<
+    * \~English
+    *  Performs a single SDR write access of 'data' to register 'address'.
+    *
+    * \~German
+    *  Führt einen einzelnen SDR-Schreibzugriff von 'data' auf das Register
+    *  'address' aus.
+    */
+
+
+   uint8_t ucifWideRead(const uint16_t address);
+   /**<
+    * \~English
+    *  Performs a single SDR read access with a 16 bit address. The address
+    *  gets latched by the two DDR strobes while E is '1', see ucif.v.
+    *  @return The content of register 'address'.
+    *
+    * \~German
+    *  Führt einen einzelnen SDR-Lesezugriff mit 16-Bit-Adresse aus. Die
+    *  Adresse wird durch die zwei DDR-Strobes bei E = '1' übernommen, siehe
+    *  ucif.v.
+    *  @return Den Inhalt des Registers 'address'.
+    */
+
+
+   void ucifWideWrite(const uint16_t address, const uint8_t data);
+   /**<
+    * \~English
+    *  Performs a single SDR write access of 'data' to register 'address'
+    *  with a 16 bit address.
+    *
+    * \~German
+    *  Führt einen einzelnen SDR-Schreibzugriff von 'data' auf das Register
+    *  'address' mit 16-Bit-Adresse aus.
+    */
+
+
+   void ucifKernelWrite(const uint8_t *data, uint8_t words);
+   /**<
+    * \~English
+    *  Writes 'words' byte pairs from 'data' to the UCIF, this serves
+    *  SDR-WR (address, data) and DDR-WR (data, data) alike. The DDR line
+    *  selects the cycle, the caller sets it together with RW = '0', E = '0'
+    *  and the data lines as outputs.
+    *  Cycle budget at 8 MHz, 11 cycles per pair (1.45 MByte/s): E stays
+    *  '1' for 3 cycles and '0' for 6 cycles, the data lines change 3
+    *  cycles after an edge on E. The FPGA samples E through a 2-flop
+    *  syncstage at 50 MHz and takes the data within 60 ns (th) after the
+    *  edge, any cycle of 125 ns covers that.
+    *
+    * \~German
+    *  Schreibt 'words' Bytepaare aus 'data' zum UCIF, das dient SDR-WR
+    *  (Adresse, Daten) und DDR-WR (Daten, Daten) gleichermaßen. Die
+    *  DDR-Leitung wählt den Zyklus, der Aufrufer setzt sie zusammen mit
+    *  RW = '0', E = '0' und den Datenleitungen als Ausgänge.
+    *  Taktbudget bei 8 MHz, 11 Takte je Paar (1,45 MByte/s): E bleibt 3
+    *  Takte '1' und 6 Takte '0', die Datenleitungen ändern sich 3 Takte nach
+    *  einer Flanke auf E. Das FPGA tastet E über eine 2-Flop-Syncstage mit
+    *  50 MHz ab und übernimmt die Daten innerhalb von 60 ns (th) nach der
+    *  Flanke, jeder Takt von 125 ns deckt das ab.
+    */
+
+
+   void ucifKernelWriteFifo(volatile uint8_t *fifo, uint8_t words);
+   /**<
+    * \~English
+    *  Like ucifKernelWrite(), but reads all bytes from the data register
+    *  'fifo', e.g. UEDATX of the selected OUT endpoint. Same cycle budget.
+    *
+    * \~German
+    *  Wie ucifKernelWrite(), liest aber alle Bytes aus dem Datenregister
+    *  'fifo', z.B. UEDATX des ausgewählten OUT-Endpunkts. Gleiches
+    *  Taktbudget.
+    */
+
+
+   void ucifKernelSdrRead(const uint8_t *address, uint8_t count, volatile uint8_t *fifo);
+   /**<
+    * \~English
+    *  Reads the 'count' registers listed at 'address' and writes their
+    *  contents to the data register 'fifo', e.g. UEDATX of the selected IN
+    *  endpoint. The caller sets DDR = '0', E = '0', RW = '1' and the data
+    *  lines as inputs, the kernel leaves them so.
+    *  Cycle budget at 8 MHz, 16 cycles per register (500 kAccesses/s): The
+    *  address gets driven 1 cycle after RW fell and 1 cycle ahead of the
+    *  rising edge of E. RW rises 2 cycles later, 1 cycle ahead of the
+    *  falling edge of E, so the syncstages of the FPGA see RW = '1' first
+    *  and no write happens. The data lines get sampled 2 cycles after RW
+    *  rose, the FPGA had the register selected for 4 cycles then.
+    *
+    * \~German
+    *  Liest die 'count' bei 'address' aufgeführten Register und schreibt
+    *  ihre Inhalte in das Datenregister 'fifo', z.B. UEDATX des
+    *  ausgewählten IN-Endpunkts. Der Aufrufer setzt DDR = '0', E = '0',
+    *  RW = '1' und die Datenleitungen als Eingänge, der Kern hinterlässt sie
+    *  so.
+    *  Taktbudget bei 8 MHz, 16 Takte je Register (500 kZugriffe/s): Die
+    *  Adresse wird 1 Takt nach der fallenden Flanke von RW und 1 Takt vor
+    *  der steigenden Flanke von E ausgegeben. RW steigt 2 Takte später, 1
+    *  Takt vor der fallenden Flanke von E, die Syncstages des FPGA sehen
+    *  also zuerst RW = '1' und es erfolgt kein Schreibzugriff. Die
+    *  Datenleitungen werden 2 Takte nach der steigenden Flanke von RW
+    *  gelesen, das FPGA hatte das Register dann seit 4 Takten ausgewählt.
+    */
+
+
+   void ucifKernelDdrRead(uint8_t words, volatile uint8_t *fifo);
+   /**<
+    * \~English
+    *  Reads 'words' DDR words and writes them to the data register 'fifo'.
+    *  The caller sets DDR = '1', E = '0', RW = '1' and the data lines as
+    *  inputs.
+    *  Cycle budget at 8 MHz, 11 cycles per word (1.45 MByte/s): The data
+    *  lines get sampled 3 cycles after the rising edge of E and 5 cycles
+    *  after the falling edge, well beyond the 2-flop syncstage and the
+    *  response time of the FPGA.
+    *
+    * \~German
+    *  Liest 'words' DDR-Worte und schreibt sie in das Datenregister 'fifo'.
+    *  Der Aufrufer setzt DDR = '1', E = '0', RW = '1' und die
+    *  Datenleitungen als Eingänge.
+    *  Taktbudget bei 8 MHz, 11 Takte je Wort (1,45 MByte/s): Die
+    *  Datenleitungen werden 3 Takte nach der steigenden und 5 Takte nach der
+    *  fallenden Flanke von E gelesen, weit jenseits der 2-Flop-Syncstage und
+    *  der Antwortzeit des FPGA.
+    */
+
+
+   void ucifModify(const uint8_t op, const uint8_t address, const uint8_t mask, const uint8_t value);
+   /**<
+    * \~English
+    *  Reads register 'address', changes it according to 'op' and writes it
+    *  back. UCIF_OP_MASKED replaces the bits set in 'mask' by those of
+    *  'value'. UCIF_OP_SET, UCIF_OP_CLEAR and UCIF_OP_TOGGLE change the bits
+    *  set in 'mask' and ignore 'value'.
+    *
+    * \~German
+    *  Liest das Register 'address', ändert es gemäß 'op' und schreibt es
+    *  zurück. UCIF_OP_MASKED ersetzt die in 'mask' gesetzten Bits durch die
+    *  aus 'value'. UCIF_OP_SET, UCIF_OP_CLEAR und UCIF_OP_TOGGLE ändern die
+    *  in 'mask' gesetzten Bits und ignorieren 'value'.
+    */
+
+
 #endif
@@ -41,15 +41,20 @@
 #include <avr/wdt.h>
 #include <avr/io.h>
 #include <util/delay.h>
+#include <util/crc16.h>
+#include <stdlib.h>
 #include "stdio.h"
 #include <LUFA/Drivers/USB/USB.h>
-#include <LUFA/Drivers/Misc/RingBuffer.h>
 #include <LUFA/Platform/Platform.h>
 
 #include "./Fct.h"
 #include "./Fpga/fpga.h"
 #include "./SPI-flash/flash.h"
 #include "./Ucif/ucif.h"
+#include "./Msc/msc.h"
+#include "./Macro/macro.h"
+#include "./Shadow/shadow.h"
+#include "./Ring/ring.h"
 #include "./Config/AppConfig.h"
 #include "./Descriptors.h"
 
@@ -94,6 +99,119 @@ USB_ClassInfo_CDC_Device_t VirtualSerial_CDC_Interface =
    };
 
 
+#if defined(DUAL_CDC)
+/**
+ *  \~English
+ *   LUFA CDC Class driver interface configuration and state information of
+ *   the console. It is the second CDC function of the composite device.
+ *
+ *  \~German
+ *   Schnittstelleneinstellungen und Statusinformationen des LUFA
+ *   CDC-Klassentreibers fr die Konsole. Sie ist die zweite CDC-Funktion des
+ *   Verbundgertes.
+ */
+USB_ClassInfo_CDC_Device_t Console_CDC_Interface =
+   {
+      .Config =
+         {
+            .ControlInterfaceNumber = INTERFACE_ID_CONSOLE_CCI,
+            .DataINEndpoint         =
+               {
+                  .Address          = CONSOLE_TX_EPADDR,
+                  .Size             = CDC_TXRX_EPSIZE,
+                  .Banks            = 1,
+               },
+            .DataOUTEndpoint =
+               {
+                  .Address          = CONSOLE_RX_EPADDR,
+                  .Size             = CDC_TXRX_EPSIZE,
+                  .Banks            = 1,
+               },
+            .NotificationEndpoint =
+               {
+                  .Address          = CONSOLE_NOTIFICATION_EPADDR,
+                  .Size             = CDC_NOTIFICATION_EPSIZE,
+                  .Banks            = 1,
+               },
+         },
+   };
+
+   #define  CONSOLE_INTERFACE    Console_CDC_Interface       /**< \~English The CDC interface running the command line. \~German Die CDC-Schnittstelle der Kommandozeile. */
+#else
+   #define  CONSOLE_INTERFACE    VirtualSerial_CDC_Interface /**< \~English The CDC interface running the command line. \~German Die CDC-Schnittstelle der Kommandozeile. */
+#endif
+
+
+#if defined(HID_LINK)
+/**
+ *  \~English
+ *   LUFA HID Class driver interface configuration and state information of
+ *   the register access HID. There is no previous report buffer, a report
+ *   is sent only when there is an answer pending.
+ *
+ *  \~German
+ *   Schnittstelleneinstellungen und Statusinformationen des LUFA
+ *   HID-Klassentreibers fr die Registerzugriffe. Es gibt keinen Puffer fr
+ *   den vorherigen Report, ein Report wird nur gesendet wenn eine Antwort
+ *   ansteht.
+ */
+USB_ClassInfo_HID_Device_t UCIF_HID_Interface =
+   {
+      .Config =
+         {
+            .InterfaceNumber        = INTERFACE_ID_HID,
+            .ReportINEndpoint       =
+               {
+                  .Address          = HID_IN_EPADDR,
+                  .Size             = HID_REPORT_SIZE,
+                  .Banks            = 1,
+               },
+            .PrevReportINBuffer     = NULL,
+            .PrevReportINBufferSize = HID_REPORT_SIZE,
+         },
+   };
+
+
+static uint8_t          hidRequest[HID_REPORT_SIZE];  /**< \~English Last request received by SET_REPORT. \~German Letzte per SET_REPORT empfangene Anfrage. */
+static uint8_t          hidAnswer[HID_REPORT_SIZE];   /**< \~English Answer to send by the IN endpoint. \~German Per IN-Endpunkt zu sendende Antwort. */
+static volatile uint8_t hidRequestPending = 0;        /**< \~English !'0' while 'hidRequest' awaits processing. \~German !'0' solange 'hidRequest' auf Verarbeitung wartet. */
+static volatile uint8_t hidAnswerPending = 0;         /**< \~English !'0' while 'hidAnswer' awaits sending. \~German !'0' solange 'hidAnswer' auf das Senden wartet. */
+#endif
+
+
+#if defined(MSC_DRIVE)
+/**
+ *  \~English
+ *   LUFA Mass Storage Class driver interface configuration and state
+ *   information of the configuration FLASH drive.
+ *
+ *  \~German
+ *   Schnittstelleneinstellungen und Statusinformationen des LUFA
+ *   Mass-Storage-Klassentreibers fr das Laufwerk des Konfigurations-FLASH.
+ */
+USB_ClassInfo_MS_Device_t Flash_MS_Interface =
+   {
+      .Config =
+         {
+            .InterfaceNumber        = INTERFACE_ID_MSC,
+            .DataINEndpoint         =
+               {
+                  .Address          = MSC_IN_EPADDR,
+                  .Size             = MSC_IO_EPSIZE,
+                  .Banks            = 1,
+               },
+            .DataOUTEndpoint        =
+               {
+                  .Address          = MSC_OUT_EPADDR,
+                  .Size             = MSC_IO_EPSIZE,
+                  .Banks            = 1,
+               },
+            .TotalLUNs              = 1,
+         },
+   };
+#endif
+
+
 /**
  *  \~English
  *   Standard file stream for the CDC interface when set up, so that the
@@ -130,6 +248,57 @@ static FILE USBSerialStream;
 #define  APP_UCIF_DDR_WR             3 /**< \~English Processes a Double Data Rate write access packet. \~German Verarbeitet ein Double Data Rate Schreibzugriff-Paket. */
 #define  APP_UCIF_SDR_RD             4 /**< \~English Processes a Single Data Rate read access packet. \~German Verarbeitet ein Single Data Rate Lesezugriff-Paket. */
 #define  APP_UCIF_DDR_RD             5 /**< \~English Processes a Double Data Rate read access packet. \~German Verarbeitet ein Double Data Rate Lesezugriff-Paket. */
+#define  APP_SET_OPTIONS             6 /**< \~English Processes a session option packet. \~German Verarbeitet ein Paket mit Sitzungsoptionen. */
+#define  APP_WAIT_FOR_EXT_SIZE       7 /**< \~English Waits for the upper bytes of an extended packet size. \~German Wartet auf die oberen Bytes einer erweiterten Paketgre. */
+#define  APP_UCIF_DDR_STREAM         8 /**< \~English Streams Double Data Rate reads to the host. \~German Sendet fortlaufend Double Data Rate Lesezugriffe zum Host. */
+#define  APP_WAIT_FOR_BASE_ADDRESS   9 /**< \~English Waits for the base address of a burst packet. \~German Wartet auf die Startadresse eines Burst-Pakets. */
+#define  APP_UCIF_BURST_WR          10 /**< \~English Processes a burst write access packet. \~German Verarbeitet ein Burst-Schreibzugriff-Paket. */
+#define  APP_UCIF_BURST_RD          11 /**< \~English Processes a burst read access packet. \~German Verarbeitet ein Burst-Lesezugriff-Paket. */
+#define  APP_UCIF_MODIFY            12 /**< \~English Processes a read-modify-write packet. \~German Verarbeitet ein Lesen-ndern-Schreiben-Paket. */
+#define  APP_WAIT_FOR_POLL_SETUP    13 /**< \~English Waits for the condition and times of a poll packet. \~German Wartet auf Bedingung und Zeiten eines Abfragepakets. */
+#define  APP_WAIT_FOR_MACRO_SLOT    14 /**< \~English Waits for the slot of a macro record packet. \~German Wartet auf den Platz eines Makroaufzeichnungspakets. */
+#define  APP_MACRO_RECORD           15 /**< \~English Stores a macro body into the EEPROM. \~German Speichert einen Makroinhalt ins EEPROM. */
+#define  APP_WAIT_FOR_SAMPLE_PERIOD 16 /**< \~English Waits for the period of a sampling packet. \~German Wartet auf die Periode eines Abtastpakets. */
+#define  APP_SAMPLE_REGISTERS       17 /**< \~English Collects the register list of a sampling packet. \~German Sammelt die Registerliste eines Abtastpakets. */
+#define  APP_UCIF_SAMPLE            18 /**< \~English Sends the samples taken by Timer3 to the host. \~German Sendet die von Timer3 genommenen Abtastwerte zum Host. */
+#define  APP_WAIT_FOR_CAPTURE_SETUP 19 /**< \~English Waits for the trigger setup of a capture packet. \~German Wartet auf die Triggereinstellung eines Aufzeichnungspakets. */
+#define  APP_UCIF_CAPTURE           20 /**< \~English Captures samples until the trigger window is complete. \~German Zeichnet auf, bis das Triggerfenster vollstndig ist. */
+#define  APP_UCIF_WIDE_WR           21 /**< \~English Processes a write access packet with 16 bit addresses. \~German Verarbeitet ein Schreibzugriff-Paket mit 16-Bit-Adressen. */
+#define  APP_UCIF_WIDE_RD           22 /**< \~English Processes a read access packet with 16 bit addresses. \~German Verarbeitet ein Lesezugriff-Paket mit 16-Bit-Adressen. */
+#define  APP_FPGA_CONFIGURE         23 /**< \~English Feeds the bitstream of a reconfiguration packet into the FPGA. \~German Speist den Bitstream eines Rekonfigurationspakets ins FPGA. */
+#define  APP_UCIF_POLL              24 /**< \~English Reads the register of a poll packet when due, once per loop pass at most. \~German Liest das Register eines Abfragepakets bei Flligkeit, hchstens einmal je Schleifendurchlauf. */
+
+#define  APP_CHUNK_WORDS           255 /**< \~English Words of an extended packet processed per chunk. \~German Je Abschnitt verarbeitete Worte eines erweiterten Pakets. */
+
+#define  SAMPLE_REGS                16 /**< \~English Registers per sample at most. \~German Hchstens Register je Abtastung. */
+#define  SAMPLE_BUFFER_SIZE         64 /**< \~English Bytes buffered between Timer3 and the host, power of two. \~German Zwischen Timer3 und Host gepufferte Bytes, Zweierpotenz. */
+#define  CAPTURE_BURST             255 /**< \~English Samples captured per loop pass. \~German Je Schleifendurchlauf aufgezeichnete Abtastwerte. */
+
+#define  BENCH_KERNELS               4 /**< \~English Kernels measured by ucifBenchmark(). \~German Von ucifBenchmark() gemessene Kerne. */
+#define  BENCH_WORDS               255 /**< \~English Words per kernel run of ucifBenchmark(). \~German Worte je Kernlauf von ucifBenchmark(). */
+
+#define  FRAME_SYNC               0x7E /**< \~English Marks the start of a frame. \~German Markiert den Anfang eines Rahmens. */
+#define  FRAME_HEADER                5 /**< \~English Frame bytes ahead of the payload: sync, sequence, length, CRC. \~German Rahmenbytes vor den Nutzdaten: Sync, Folgenummer, Lnge, CRC. */
+#define  FRAME_PAYLOAD_MAX         119 /**< \~English Payload bytes per frame at most, the whole frame fits into the receive ring next to the up to 4 bytes of a packet spanning frames. \~German Hchstens Nutzdatenbytes je Rahmen, der ganze Rahmen passt neben die bis zu 4 Bytes eines rahmenbergreifenden Pakets in den Empfangsring. */
+#define  FRAME_NAK_CRC             'C' /**< \~English NAK reason: CRC mismatch. \~German NAK-Grund: CRC falsch. */
+#define  FRAME_NAK_SEQUENCE        'S' /**< \~English NAK reason: Unexpected sequence number. \~German NAK-Grund: Unerwartete Folgenummer. */
+#define  FRAME_NAK_LENGTH          'L' /**< \~English NAK reason: Length above FRAME_PAYLOAD_MAX. \~German NAK-Grund: Lnge ber FRAME_PAYLOAD_MAX. */
+
+#define  OPT_FLUSH_TIMEOUT         'F' /**< \~English Option: Flush timeout in ms, 0 = every loop pass. \~German Option: Wartezeit bis zum Absenden in ms, 0 = jeder Schleifendurchlauf. */
+#define  OPT_EVENT_BASE            'E' /**< \~English Option: First status register of an event packet. \~German Option: Erstes Statusregister eines Ereignispakets. */
+#define  OPT_EVENT_COUNT           'N' /**< \~English Option: Status registers per event packet, 0 = no events. \~German Option: Statusregister je Ereignispaket, 0 = keine Ereignisse. */
+#define  OPT_SHADOW_STATIC         'D' /**< \~English Option: Declare a register static for the shadow. \~German Option: Ein Register fr den Schatten als statisch erklren. */
+#define  OPT_SHADOW_VOLATILE       'U' /**< \~English Option: Declare a register not static for the shadow. \~German Option: Ein Register fr den Schatten als nicht statisch erklren. */
+#define  OPT_FRAMING               'C' /**< \~English Option: 1 = framed mode with sequence number and CRC, 0 = plain packets. \~German Option: 1 = Rahmenmodus mit Folgenummer und CRC, 0 = einfache Pakete. */
+#define  OPT_WRITE_ACK             'A' /**< \~English Option: Write packets per cumulative ack, 0 = echo each packet, 255 = on request only. \~German Option: Schreibpakete je Sammelquittung, 0 = jedes Paket zurcksenden, 255 = nur auf Anfrage. */
+
+#define  ACK_ON_REQUEST            255 /**< \~English Write ack option value: No periodic ack. \~German Wert der Quittungsoption: Keine regelmige Quittung. */
+#define  ACK_FLAG_UNKNOWN         0x01 /**< \~English Ack flag: Unknown packet received. \~German Quittungsflag: Unbekanntes Paket empfangen. */
+
+#define  STARTUP_USB_INIT            0 /**< \~English Time stamp: USB_Init() done. \~German Zeitstempel: USB_Init() erledigt. */
+#define  STARTUP_CONFIGURED          1 /**< \~English Time stamp: Configuration selected by the host. \~German Zeitstempel: Konfiguration vom Host ausgewhlt. */
+#define  STARTUP_FIRST_BYTE          2 /**< \~English Time stamp: First CDC byte received. \~German Zeitstempel: Erstes CDC-Byte empfangen. */
+#define  STARTUP_STAMPS              3 /**< \~English Count of time stamps. \~German Anzahl der Zeitstempel. */
 
 
 const char PROGMEM greetStr[]    = "\r\n\n* Mojo OS *\r\n" \
@@ -142,6 +311,8 @@ const char PROGMEM failStr[]     = "\r\nFAIL";
 const char PROGMEM emptyStr[]    = "\r\nConfig FLASH is empty";
 const char PROGMEM wrongStr[]    = "\r\nNot a Microchip FLASH";
 const char PROGMEM invalidStr[]  = "\r\nInvalid bitstream";
+const char PROGMEM configdStr[]  = "\r\nFPGA configured";
+const char PROGMEM blankStr[]    = "\r\nFPGA not configured";
 //const char PROGMEM unequalStr[]  = "\r\nMismatch";
 const char PROGMEM helpStr[]     = "\r\nCommands:\r\n" \
                                    " V: Volatile Config\r\n" \
@@ -149,7 +320,27 @@ const char PROGMEM helpStr[]     = "\r\nCommands:\r\n" \
                                    " W: Write to FLASH\r\n" \
                                    " C: Config from FLASH\r\n" \
                                    " i: Info about FLASH\r\n" \
+                                   " s: Status of FPGA\r\n"
+#if defined(STARTUP_TIMING)
+                                   " t: Startup timing\r\n"
+#endif
+#if defined(UCIF_BENCHMARK)
+                                   " b: UCIF bus benchmark, reads\r\n" \
+                                   " B: UCIF bus benchmark, writes too\r\n"
+#endif
                                    " ?: Help\r\n";
+#if defined(STARTUP_TIMING)
+const char PROGMEM startupStr[]  = "\r\nStartup [ms]: USB_Init ";
+const char PROGMEM configStr[]   = ", Configured ";
+const char PROGMEM firstStr[]    = ", First byte ";
+#endif
+#if defined(UCIF_BENCHMARK)
+const char PROGMEM benchStr[]    = "\r\nUCIF [cycles/255 words, byte/s]:";
+const char PROGMEM sdrWrStr[]    = "\r\n SDR-WR ";
+const char PROGMEM sdrRdStr[]    = "\r\n SDR-RD ";
+const char PROGMEM ddrWrStr[]    = "\r\n DDR-WR ";
+const char PROGMEM ddrRdStr[]    = "\r\n DDR-RD ";
+#endif
 
 
 void p(const char *str)
@@ -162,6 +353,59 @@ volatile uint16_t *const bootKeyPtr = (volatile uint16_t*)0x0800;
 volatile uint16_t *const cfgKeyPtr = (volatile uint16_t*)0x0802;
 
 
+/**
+ *  \~English
+ *   Free running count of USB frames, incremented by each SOF event.
+ *
+ *  \~German
+ *   Freilaufender Zhler der USB-Frames, jedes SOF-Ereignis erhht ihn.
+ */
+static volatile uint8_t frameCount;
+
+
+static uint8_t  sampleRegs[SAMPLE_REGS];            /**< \~English Registers read per sample. \~German Je Abtastung gelesene Register. */
+static uint8_t  sampleCount;                       /**< \~English Count of 'sampleRegs' in use. \~German Anzahl der benutzten 'sampleRegs'. */
+static uint8_t  sampleSeq;                         /**< \~English Sequence number of the next sample. \~German Folgenummer der nchsten Abtastung. */
+static uint8_t  sampleMemory[SAMPLE_BUFFER_SIZE];  /**< \~English Memory of 'sampleRing'. \~German Speicher von 'sampleRing'. */
+static ring_t   sampleRing;                        /**< \~English Samples taken, filled by the Timer3 ISR. \~German Genommene Abtastwerte, von der Timer3-ISR gefllt. */
+static uint8_t  frameSeq;                          /**< \~English Sequence number of the next frame expected. \~German Folgenummer des nchsten erwarteten Rahmens. */
+static uint8_t  frameNakSent;                      /**< \~English !'0' after a NAK until a frame gets accepted. \~German !'0' nach einem NAK, bis ein Rahmen angenommen wird. */
+static uint8_t  frameNakReason;                    /**< \~English Reason of the NAK waiting to get sent, '0' if none. \~German Grund des zu sendenden NAK, '0' wenn keiner. */
+static uint8_t  pollAddress;                       /**< \~English Register polled. \~German Abgefragtes Register. */
+static uint8_t  pollMask;                          /**< \~English Bits of the poll condition. \~German Bits der Abfragebedingung. */
+static uint8_t  pollValue;                         /**< \~English Value of the poll condition. \~German Wert der Abfragebedingung. */
+static uint16_t pollNext;                          /**< \~English Timer1 count of the next read due. \~German Timer1-Stand des nchsten flligen Zugriffs. */
+static uint16_t pollStep;                          /**< \~English Timer1 counts between the reads. \~German Timer1-Schritte zwischen den Zugriffen. */
+static uint16_t pollLimit;                         /**< \~English Timer1 count of the timeout. \~German Timer1-Stand der Zeitberschreitung. */
+static uint8_t  pollTimerControl;                  /**< \~English TCCR1B saved while polling. \~German Whrend der Abfrage gesichertes TCCR1B. */
+static uint16_t pollTimerCount;                    /**< \~English TCNT1 saved while polling. \~German Whrend der Abfrage gesichertes TCNT1. */
+
+
+#if defined(ATTENTION_EVENTS)
+/**
+ *  \~English
+ *   Set by INT6 when the FPGA requests attention, cleared by the
+ *   application loop.
+ *
+ *  \~German
+ *   Wird von INT6 gesetzt, wenn das FPGA Aufmerksamkeit anfordert, die
+ *   Anwendungsschleife lscht es.
+ */
+static volatile uint8_t attention;
+#endif
+
+
+static uint8_t  cliState = CLI_WAIT_FOR_CONNECT;   /**< \~English Recent state of the command line. \~German Aktueller Zustand der Kommandozeile. */
+static uint8_t  cfgSrc = 0;                        /**< \~English Source of the bitstream. \~German Quelle des Bitstreams. */
+static uint32_t flashAddr = 0;                     /**< \~English Byte count processed so far. \~German Anzahl der bisher verarbeiteten Bytes. */
+static uint32_t fileSize = 0;                      /**< \~English Byte count still to process. \~German Anzahl der noch zu verarbeitenden Bytes. */
+static uint8_t  aBuffer[WORK_BUFFER_SIZE];         /**< \~English Bitstream buffer, at least max(4*CDC_TXRX_EPSIZE, 256). The application loop uses it as capture buffer, the size must be even. \~German Puffer fr den Bitstream, mindestens max(4*CDC_TXRX_EPSIZE, 256). Die Anwendungsschleife nutzt ihn als Aufzeichnungspuffer, die Gre muss gerade sein. */
+#if defined(STARTUP_TIMING)
+static uint16_t startupTicks[STARTUP_STAMPS];      /**< \~English Timer1 counts of the time stamps. \~German Timer1-Stnde der Zeitstempel. */
+static uint8_t  startupTaken = 0;                  /**< \~English One bit per time stamp taken. \~German Ein Bit je genommenem Zeitstempel. */
+#endif
+
+
 int main(void)
 {
    // Disable watchdog if enabled by bootloader/fuses, only works if WDRF is
@@ -176,6 +420,16 @@ int main(void)
    // Countermeasure possible CLKDIV8
    clock_prescale_set(clock_div_1);
 
+#if defined(STARTUP_TIMING)
+   // Timer1 counts F_CPU/1024 from here on, the bootloader might have left
+   // it running.
+   TCCR1B = 0;
+   TCCR1A = 0;
+   TCNT1  = 0;
+   TIFR1  = (1 << TOV1);
+   TCCR1B = (1 << CS12) | (1 << CS10);
+#endif
+
    // Enable a weak pullup to unusable GPIOs. This prevents pins from floating,
    // it has no risk if GNDed by layout. Schematic tells those are unconnected
    // so we should not get some "a few dozen more A current draw" penalty.
@@ -184,20 +438,39 @@ int main(void)
    DDRD  &= ~(1 << PD7);
    PORTD |=  (1 << PD7);
 
+#if defined(ATTENTION_EVENTS)
+   // PE6 keeps its pullup, the FPGA signals attention by a falling edge.
+   EICRB = (EICRB & ~((1 << ISC61) | (1 << ISC60))) | (1 << ISC61);
+   EIFR  = (1 << INTF6);
+   EIMSK |= (1 << INT6);
+#endif
+
    ucifBaseInit();
    XilinxPreparePorts();
    spiBaseInitHw();
 
    // Create a regular character stream for the interface so that it can be
    // used with the stdio.h functions
-   CDC_Device_CreateStream(&VirtualSerial_CDC_Interface, &USBSerialStream);
+   CDC_Device_CreateStream(&CONSOLE_INTERFACE, &USBSerialStream);
 
+   // Attach to the bus as early as possible, the host starts enumeration
+   // while the remaining initialization is done. Anything not needed to
+   // answer control requests goes below.
    USB_Init();
    GlobalInterruptEnable();
+#if defined(STARTUP_TIMING)
+   startupStamp(STARTUP_USB_INIT);
+#endif
+
+#if defined(MSC_DRIVE)
+   // The drive gets serviced by the main loop only, there is no need to
+   // delay the attach by reading the FLASH.
+   mscScanFlash();
+#endif
 
    for(;;)
    {
-      if (!XilinxConfigured())
+      if (!XilinxConfigured() || commandLineBusy())
          commandLineInterface();
       else
          applicationLoop();
@@ -205,287 +478,1754 @@ int main(void)
 }
 
 
+/**
+ *  \~English
+ *   Tells whether 'id' is a write packet, those can go without echo.
+ *   @return Payload bytes per count of '<Length>', 0 if no write packet.
+ *
+ *  \~German
+ *   Gibt an, ob 'id' ein Schreibpaket ist, diese knnen ohne Echo
+ *   auskommen.
+ *   @return Nutzdatenbytes je Zhler von '<Length>', 0 wenn kein
+ *   Schreibpaket.
+ */
+static inline uint8_t writePacket(const uint8_t id)
+{
+   switch (id)
+   {
+      case 'b':
+         return(1);
+      case 'w':
+      case 'W':
+      case 'X':
+      case UCIF_OP_SET:
+      case UCIF_OP_CLEAR:
+      case UCIF_OP_TOGGLE:
+         return(2);
+      case UCIF_OP_MASKED:
+      case 'h':
+         return(3);
+      default:
+         return(0);
+   }
+}
+
+
+#if defined(ATTENTION_EVENTS)
+/**
+ *  \~English
+ *   Tells whether 'id' is a DDR packet, those use the address latched by
+ *   the packet before.
+ *   @return !'0' (true) for a DDR packet.
+ *
+ *  \~German
+ *   Gibt an, ob 'id' ein DDR-Paket ist, diese benutzen die vom vorigen
+ *   Paket gesetzte Adresse.
+ *   @return !'0' (wahr) fr ein DDR-Paket.
+ */
+static inline uint8_t ddrPacket(const uint8_t id)
+{
+   switch (id)
+   {
+      case 'W':
+      case 'R':
+      case 'X':
+      case 'Y':
+      case 'S':
+         return(1);
+      default:
+         return(0);
+   }
+}
+#endif
+
+
+/**
+ *  \~English
+ *   Loads the next chunk of an extended packet into 'size'. Regular packets
+ *   have an 'extSize' of 0, they are done with their first chunk.
+ *   @return !'0' (true) if there are words left to process.
+ *
+ *  \~German
+ *   Ldt den nchsten Abschnitt eines erweiterten Pakets nach 'size'.
+ *   Normale Pakete haben eine 'extSize' von 0, sie sind mit ihrem ersten
+ *   Abschnitt erledigt.
+ *   @return !'0' (true) wenn noch Worte zu verarbeiten sind.
+ */
+static inline uint8_t nextChunk(uint8_t *const size, uint32_t *const extSize)
+{
+   uint8_t chunk = (*extSize > APP_CHUNK_WORDS) ? APP_CHUNK_WORDS : (uint8_t)*extSize;
+
+   *extSize -= chunk;
+   *size = chunk;
+   return(chunk);
+}
+
+
+/**
+ *  \~English
+ *   Starts Timer3 sampling the registers in 'sampleRegs' every 'period'
+ *   counts of F_CPU/64.
+ *
+ *  \~German
+ *   Startet die Abtastung der Register in 'sampleRegs' durch Timer3 alle
+ *   'period' Takte von F_CPU/64.
+ */
+static inline void sampleStart(const uint16_t period)
+{
+   ringInit(&sampleRing, sampleMemory, sizeof(sampleMemory));
+   sampleSeq = 0;
+   TCCR3B = 0;
+   TCCR3A = 0;
+   TCNT3  = 0;
+   OCR3A  = period - 1;
+   TIFR3  = (1 << OCF3A);
+   TIMSK3 = (1 << OCIE3A);
+   TCCR3B = (1 << WGM32) | (1 << CS31) | (1 << CS30);
+}
+
+
+/**
+ *  \~English
+ *   Stops Timer3 sampling.
+ *
+ *  \~German
+ *   Hlt die Abtastung durch Timer3 an.
+ */
+static inline void sampleStop(void)
+{
+   TIMSK3 = 0;
+   TCCR3B = 0;
+}
+
+
+/**
+ *  \~English
+ *   Holds the Timer3 sampling off while the main loop accesses PORTB or the
+ *   sample ring. A sample due gets taken late, not lost.
+ *
+ *  \~German
+ *   Hlt die Abtastung durch Timer3 zurck, whrend die Hauptschleife auf
+ *   PORTB oder den Abtastpuffer zugreift. Eine fllige Abtastung erfolgt
+ *   versptet, geht aber nicht verloren.
+ */
+static inline void samplePause(void)
+{
+   TIMSK3 &= ~(1 << OCIE3A);
+}
+
+
+/**
+ *  \~English
+ *   Lets the Timer3 sampling continue after samplePause(), if it is
+ *   running.
+ *
+ *  \~German
+ *   Setzt die Abtastung durch Timer3 nach samplePause() fort, falls sie
+ *   luft.
+ */
+static inline void sampleResume(void)
+{
+   if (TCCR3B != 0)
+      TIMSK3 |= (1 << OCIE3A);
+}
+
+
+/**
+ *  \~English
+ *   Queues a negative acknowledge, just one until the next frame gets
+ *   accepted. A damaged frame might contain more sync markers, those would
+ *   cause more NAKs otherwise. frameNakSend() puts it out.
+ *
+ *  \~German
+ *   Stellt eine negative Quittung zum Senden bereit, nur eine bis zum
+ *   nchsten angenommenen Rahmen. Ein beschdigter Rahmen kann weitere
+ *   Sync-Marken enthalten, die sonst weitere NAKs auslsen wrden.
+ *   frameNakSend() gibt sie aus.
+ */
+static void frameNak(const uint8_t reason)
+{
+   if (frameNakSent)
+      return;
+   frameNakReason = reason;
+   frameNakSent = 1;
+}
+
+
+/**
+ *  \~English
+ *   Sends the NAK queued by frameNak(). The caller makes sure no answer is
+ *   in progress, the NAK must not split one.
+ *
+ *  \~German
+ *   Sendet das von frameNak() bereitgestellte NAK. Der Aufrufer stellt
+ *   sicher, dass keine Antwort in Arbeit ist, das NAK darf keine teilen.
+ */
+static void frameNakSend(void)
+{
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, 'n');
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, 2);
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, frameSeq);
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, frameNakReason);
+   frameNakReason = 0;
+}
+
+
+/**
+ *  \~English
+ *   Checks the next frame in 'raw' and hands its payload over to 'rx'. Both
+ *   rings share their memory, 'raw' gets filled by cdcReceive(), 'rx' gets
+ *   read by the packet processing and releases the memory of 'raw' as it
+ *   gets read. 'raw' starts where 'rx' ends. The bytes still pending in
+ *   'rx' move up to the payload, so a packet may span several frames.
+ *   Damaged frames get dropped up to their sync marker, so the next sync
+ *   marker starts over at once.
+ *
+ *  \~German
+ *   Prft den nchsten Rahmen in 'raw' und bergibt seine Nutzdaten an
+ *   'rx'. Beide Ringpuffer teilen sich ihren Speicher, 'raw' wird von
+ *   cdcReceive() gefllt, 'rx' wird von der Paketverarbeitung gelesen und
+ *   gibt den Speicher von 'raw' frei, whrend er gelesen wird. 'raw'
+ *   beginnt, wo 'rx' endet. Die in 'rx' noch anstehenden Bytes rcken bis
+ *   an die Nutzdaten auf, ein Paket darf sich also ber mehrere Rahmen
+ *   erstrecken. Beschdigte Rahmen werden bis zu ihrer Sync-Marke
+ *   verworfen, so dass mit der nchsten Sync-Marke sofort neu begonnen
+ *   wird.
+ */
+static void frameRelease(ring_t *const raw, ring_t *const rx)
+{
+   uint8_t length = 0;
+
+   raw->tail = rx->head;
+   while ((ringCount(raw) > 0) && (ringPeekAt(raw, 0) != FRAME_SYNC))
+      ringConsumeN(raw, 1);
+   if (ringCount(raw) >= FRAME_HEADER)
+   {
+      length = ringPeekAt(raw, 2);
+      if (length > FRAME_PAYLOAD_MAX)
+      {
+         frameNak(FRAME_NAK_LENGTH);
+         ringConsumeN(raw, 1);
+         length = 0;
+      }
+      else if (ringCount(raw) < (FRAME_HEADER + length))
+         length = 0;
+      else
+      {
+         uint16_t crc = 0;
+
+         crc = _crc_xmodem_update(crc, ringPeekAt(raw, 1));
+         crc = _crc_xmodem_update(crc, length);
+         for (uint8_t n = 0; n < length; n++)
+            crc = _crc_xmodem_update(crc, ringPeekAt(raw, FRAME_HEADER + n));
+         if (crc != (ringPeekAt(raw, 3) | ((uint16_t)ringPeekAt(raw, 4) << 8)))
+         {
+            frameNak(FRAME_NAK_CRC);
+            ringConsumeN(raw, 1);
+            length = 0;
+         }
+         else if (ringPeekAt(raw, 1) != frameSeq)
+         {
+            // Intact but out of order, the host resends from 'frameSeq'.
+            frameNak(FRAME_NAK_SEQUENCE);
+            ringConsumeN(raw, FRAME_HEADER + length);
+            length = 0;
+         }
+         else
+         {
+            frameSeq++;
+            frameNakSent = 0;
+            frameNakReason = 0;     // the host resent already
+            ringConsumeN(raw, FRAME_HEADER);
+         }
+      }
+   }
+
+   // Move the pending bytes over what 'raw' consumed, then release the
+   // payload right behind them.
+   uint8_t skip = raw->tail - rx->head;
+
+   if (skip != 0)
+   {
+      for (uint8_t n = ringCount(rx); n > 0; n--)
+         rx->buffer[(uint8_t)(rx->tail + skip + n - 1) & rx->mask] =
+            rx->buffer[(uint8_t)(rx->tail + n - 1) & rx->mask];
+      ringInsertN(rx, skip);
+      ringConsumeN(rx, skip);
+   }
+   ringInsertN(rx, length);
+}
+
+
 void applicationLoop(void)
 {
    uint8_t        buffermemory[2*CDC_TXRX_EPSIZE];
-   RingBuffer_t   inBuffer;
+   ring_t         inBuffer;
+   ring_t         rawBuffer;
    uint8_t        id = 0;
    uint8_t        size = 0;
+   uint32_t       extSize = 0;
+   uint8_t        endless = 0;
+   uint8_t        address = 0;
+   uint8_t        macro = 0;
+   uint8_t        eventBase = 0;
+   uint8_t        eventCount = 0;
+   uint16_t       period = 0;
+   uint8_t        framed = 0;
+   uint8_t        framing = 0;
+   uint16_t       capPos = 0;
+   uint16_t       capFilled = 0;
+   uint16_t       capPost = 0;
+   uint16_t       capLeft = 0;
+   uint8_t        capMask = 0;
+   uint8_t        capValue = 0;
+   uint8_t        capTriggered = 0;
+   uint8_t        ackInterval = 0;
+   uint8_t        ackCountdown = 0;
+   uint8_t        ackDue = 0;
+   uint8_t        ackFlags = 0;
+   uint16_t       ackPackets = 0;
+   uint32_t       ackBytes = 0;
    uint8_t        appState = APP_WAIT_FOR_PACKET_ID;
+   uint8_t        flushTimeout = FLUSH_TIMEOUT_MS;
+   uint8_t        flushFrame = frameCount;
 
    ucifBaseInit();
-   RingBuffer_InitBuffer(&inBuffer, buffermemory, sizeof(buffermemory));
+   sampleStop();
+   ringInit(&inBuffer, buffermemory, sizeof(buffermemory));
+#if defined(ATTENTION_EVENTS)
+   attention = 0;
+#endif
+#if defined(SHADOW_SIZE)
+   shadowReset();
+#endif
 
    for(;;)
    {
-
-      CDC_Device_USBTask(&VirtualSerial_CDC_Interface);
+      // CDC_Device_USBTask() is left out intentionally. All it does is to
+      // flush the IN endpoint, the flush policy at the end of the loop takes
+      // care of that here.
       USB_USBTask();
 
-      uint16_t rxCount = CDC_Device_BytesReceived(&VirtualSerial_CDC_Interface);
-      uint16_t freeCount = RingBuffer_GetFreeCount(&inBuffer);
-      uint16_t count = (freeCount > rxCount) ? rxCount : freeCount;
-      for (; count > 0; count--)
-         RingBuffer_Insert(&inBuffer, CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface));
+#if defined(DUAL_CDC)
+      CDC_Device_USBTask(&Console_CDC_Interface);
+      // FLASH and FPGA are left alone while a bitstream is processed.
+      if (appState != APP_FPGA_CONFIGURE)
+      {
+         // The console might access the FLASH, which shares PORTB with the
+         // UCIF. With RW = '0' the FPGA keeps its data lines released.
+         samplePause();
+         UCIF_RW_CLR;
+         commandLineTask();
+         sampleResume();
+      }
+      if (commandLineBusy())
+      {
+         // The console started a job on FLASH or FPGA, it continues outside.
+         sampleStop();
+         CDC_Device_Flush(&VirtualSerial_CDC_Interface);
+         ucifBaseInit();
+         return;
+      }
+#endif
 
-      switch(appState)
+#if defined(HID_LINK)
+      HID_Device_USBTask(&UCIF_HID_Interface);
+      // HID register accesses slip in once per loop pass, whatever the CDC
+      // side is doing. DDR transfers rely on the address the host latched
+      // before and an in-session configuration owns the lines, HID requests
+      // wait for them to finish. The DDR states set the DDR line again
+      // themselves, HID accesses clear it.
+      if (hidRequestPending && !hidAnswerPending &&
+          (appState != APP_WAIT_FOR_EXT_SIZE) &&
+          (appState != APP_UCIF_DDR_WR) && (appState != APP_UCIF_DDR_RD) &&
+          (appState != APP_UCIF_DDR_STREAM) && (appState != APP_FPGA_CONFIGURE) &&
+          !((appState == APP_UCIF_CAPTURE) && (size == 2)))
       {
-         case APP_WAIT_FOR_PACKET_ID:
-            if (RingBuffer_GetCount(&inBuffer) > 0)
-            {
-               id = RingBuffer_Remove(&inBuffer);
-               appState = APP_WAIT_FOR_PACKET_SIZE;
-            }
-            break;
-         case APP_WAIT_FOR_PACKET_SIZE:
-            if (RingBuffer_GetCount(&inBuffer) > 0)
-            {
-               size = RingBuffer_Remove(&inBuffer);
-               CDC_Device_SendByte(&VirtualSerial_CDC_Interface, id);
-               CDC_Device_SendByte(&VirtualSerial_CDC_Interface, size);
-               switch(id)
+         samplePause();
+         hidTransaction();
+         sampleResume();
+      }
+#endif
+
+#if defined(MSC_DRIVE)
+      // The drive accesses the FLASH, which shares PORTB with the UCIF.
+      // With RW = '0' the FPGA keeps its data lines released.
+      if (appState != APP_FPGA_CONFIGURE)
+      {
+         samplePause();
+         UCIF_RW_CLR;
+         MS_Device_USBTask(&Flash_MS_Interface);
+         sampleResume();
+      }
+      if (mscNewBitstream())
+      {
+         // Let the command line configure the FPGA from FLASH.
+         sampleStop();
+         CDC_Device_Flush(&VirtualSerial_CDC_Interface);
+         *cfgKeyPtr = (uint16_t)0;
+         XilinxReset();
+         return;
+      }
+#endif
+
+      if (framed)
+      {
+         // The packet processing releases the memory.
+         rawBuffer.tail = inBuffer.tail;
+         cdcReceive(&rawBuffer);
+      }
+      // The payload of write packets bypasses the ring, see cdcWriteThrough().
+#if defined(SHADOW_SIZE)
+      // SDR-WR packets need to pass the shadow.
+      else if ((appState != APP_UCIF_DDR_WR) || (ringCount(&inBuffer) != 0))
+#else
+      else if (((appState != APP_UCIF_SDR_WR) && (appState != APP_UCIF_DDR_WR)) ||
+               (ringCount(&inBuffer) != 0))
+#endif
+      {
+#if defined(STARTUP_TIMING)
+         if (cdcReceive(&inBuffer) != 0)
+            startupStamp(STARTUP_FIRST_BYTE);
+#else
+         cdcReceive(&inBuffer);
+#endif
+      }
+
+      // Every request already queued gets processed in this pass. The
+      // responses share the IN packets and get flushed once below.
+      uint8_t prevState;
+      uint8_t prevCount;
+      do
+      {
+         // Frames get released as they arrive, a state waiting for more
+         // bytes of a packet gets them from the next frame.
+         if (framed)
+         {
+            frameRelease(&rawBuffer, &inBuffer);
+            // A NAK goes out where no answer is in progress: between
+            // packets or while write packets wait for their data.
+            if (frameNakReason &&
+                ((appState == APP_WAIT_FOR_PACKET_ID) ||
+                 (appState == APP_UCIF_SDR_WR) || (appState == APP_UCIF_DDR_WR)))
+               frameNakSend();
+         }
+         prevState = appState;
+         prevCount = ringCount(&inBuffer);
+
+         switch(appState)
+         {
+            case APP_WAIT_FOR_PACKET_ID:
+               if (ackDue)
                {
-                  case 'w':   // SDR-WR packet
-                     UCIF_DDR_CLR;
-                     appState = APP_UCIF_SDR_WR;
-                     break;
-                  case 'W':   // DDR-WR packet
-                     UCIF_DDR_SET;
-                     appState = APP_UCIF_DDR_WR;
-                     break;
-                  case 'r':   // SDR-RD packet
+                  cdcSendAck(ackPackets, ackBytes, ackFlags);
+                  ackFlags = 0;
+                  ackDue = 0;
+               }
+#if defined(ATTENTION_EVENTS)
+               // Events go out between packets only, they never split an
+               // answer. The status reads move the address latch, so they
+               // wait while a DDR packet is queued that relies on it.
+               if (attention &&
+                   !((ringCount(&inBuffer) > 0) && ddrPacket(ringPeekAt(&inBuffer, 0))))
+               {
+                  attention = 0;
+                  if (eventCount != 0)
+                  {
+                     CDC_Device_SendByte(&VirtualSerial_CDC_Interface, '!');
+                     CDC_Device_SendByte(&VirtualSerial_CDC_Interface, eventCount);
                      UCIF_DDR_CLR;
-                     appState = APP_UCIF_SDR_RD;
-                     break;
-                  case 'R':   // DDR-RD packet
-                     UCIF_DDR_SET;
-                     appState = APP_UCIF_DDR_RD;
-                     break;
-                  case '#':   // Return to reconfiguration
-                     if (size == 'R')
-                     {
-                        XilinxReset();
-                        *cfgKeyPtr = (uint16_t)0x1234;
-                        return;
-                     }
-                     // There is intentionally no `break;` here!
-                  default:
-                     appState = APP_WAIT_FOR_PACKET_ID;
+                     cdcSendBurst(eventBase, eventCount);
+                  }
                }
-            }
-            break;
-         case APP_UCIF_SDR_WR:
-         case APP_UCIF_DDR_WR:
-            {
-               UCIF_RW_CLR;
-               UCIF_AS_OUTPUT;
-               uint16_t ready = RingBuffer_GetCount(&inBuffer);
-               while ((ready > 1) && (size > 0))
-               {
-                  UCIF_DATA_PORT = RingBuffer_Remove(&inBuffer);
-                  UCIF_E_SET;
-                  UCIF_DATA_PORT = RingBuffer_Remove(&inBuffer);
-                  UCIF_E_CLR;
-                  ready -= 2;
-                  size--;
+#endif
+               if (ringCount(&inBuffer) > 0)
+               {
+                  id = ringRemove(&inBuffer);
+                  appState = APP_WAIT_FOR_PACKET_SIZE;
                }
-               if (size == 0)
-                  appState = APP_WAIT_FOR_PACKET_ID;
-            }
-            break;
-         case APP_UCIF_SDR_RD:
-            {
-               uint16_t ready = RingBuffer_GetCount(&inBuffer);
-               while ((ready > 0) && (size > 0))
+               break;
+            case APP_WAIT_FOR_PACKET_SIZE:
+               if (ringCount(&inBuffer) > 0)
+               {
+                  size = ringRemove(&inBuffer);
+                  if ((ackInterval != 0) && writePacket(id))
+                  {
+                     // No echo, the packet gets counted for the cumulative ack.
+                     // The bytes of an extended packet get counted once its
+                     // full length is known.
+                     ackPackets++;
+                     if (id != 'X')
+                        ackBytes += writePacket(id) * size;
+                     if ((ackInterval != ACK_ON_REQUEST) && (--ackCountdown == 0))
+                     {
+                        ackCountdown = ackInterval;
+                        ackDue = 1;
+                     }
+                  }
+                  else
+                  {
+                     CDC_Device_SendByte(&VirtualSerial_CDC_Interface, id);
+                     CDC_Device_SendByte(&VirtualSerial_CDC_Interface, size);
+                  }
+                  switch(id)
+                  {
+                     // Plain packets share nextChunk() with the extended ones,
+                     // no count of those must be left over.
+                     case 'w':   // SDR-WR packet
+                        UCIF_DDR_CLR;
+                        extSize = 0;
+                        appState = APP_UCIF_SDR_WR;
+                        break;
+                     case 'W':   // DDR-WR packet
+                        UCIF_DDR_SET;
+                        extSize = 0;
+                        appState = APP_UCIF_DDR_WR;
+                        break;
+                     case 'r':   // SDR-RD packet
+                        UCIF_DDR_CLR;
+                        extSize = 0;
+                        appState = APP_UCIF_SDR_RD;
+                        break;
+                     case 'R':   // DDR-RD packet
+                        UCIF_DDR_SET;
+                        extSize = 0;
+                        appState = APP_UCIF_DDR_RD;
+                        break;
+                     case 'h':   // Wide address SDR-WR packet
+                        appState = APP_UCIF_WIDE_WR;
+                        break;
+                     case 'H':   // Wide address SDR-RD packet
+                        appState = APP_UCIF_WIDE_RD;
+                        break;
+                     case 'X':   // Extended DDR-WR packet
+                     case 'Y':   // Extended DDR-RD packet
+                     case 'S':   // DDR streaming read packet
+                        UCIF_DDR_SET;
+                        extSize = size;
+                        appState = APP_WAIT_FOR_EXT_SIZE;
+                        break;
+                     case 'V':   // Reconfiguration packet
+                        // The DDR line is CCLK of the FPGA, it stays alone.
+                        extSize = size;
+                        appState = APP_WAIT_FOR_EXT_SIZE;
+                        break;
+                     case 'b':   // Burst write packet
+                     case 'B':   // Burst read packet
+                        UCIF_DDR_CLR;
+                        appState = APP_WAIT_FOR_BASE_ADDRESS;
+                        break;
+                     case UCIF_OP_MASKED:   // Masked write packet
+                     case UCIF_OP_SET:      // Bit set packet
+                     case UCIF_OP_CLEAR:    // Bit clear packet
+                     case UCIF_OP_TOGGLE:   // Bit toggle packet
+                        appState = APP_UCIF_MODIFY;
+                        break;
+                     case 'p':   // Poll packet
+                        appState = APP_WAIT_FOR_POLL_SETUP;
+                        break;
+                     case 'P':   // Periodic sampling packet
+                        sampleCount = 0;
+                        appState = APP_WAIT_FOR_SAMPLE_PERIOD;
+                        break;
+                     case 'C':   // Capture packet
+                        appState = APP_WAIT_FOR_CAPTURE_SETUP;
+                        break;
+                     case 'M':   // Macro record packet
+                        appState = APP_WAIT_FOR_MACRO_SLOT;
+                        break;
+                     case 'e':   // Macro execute packet
+                        macroRun(size);
+#if defined(SHADOW_SIZE)
+                        shadowInvalidate();
+#endif
+                        appState = APP_WAIT_FOR_PACKET_ID;
+                        break;
+                     case 'O':   // Session options packet
+                        appState = APP_SET_OPTIONS;
+                        break;
+                     case '#':   // Return to reconfiguration
+                        if (size == 'R')
+                        {
+                           XilinxReset();
+                           *cfgKeyPtr = (uint16_t)0x1234;
+                           return;
+                        }
+                        if (size == 'A')  // cumulative ack request
+                           ackDue = 1;
+                        appState = APP_WAIT_FOR_PACKET_ID;
+                        break;
+                     default:
+                        ackFlags |= ACK_FLAG_UNKNOWN;
+                        appState = APP_WAIT_FOR_PACKET_ID;
+                  }
+               }
+               break;
+            case APP_WAIT_FOR_EXT_SIZE:
+               if (ringCount(&inBuffer) > 1)
                {
+                  uint8_t mid = ringRemove(&inBuffer);
+                  uint8_t high = ringRemove(&inBuffer);
+
+                  extSize |= ((uint32_t)high << 16) | ((uint16_t)mid << 8);
+                  if ((ackInterval != 0) && writePacket(id))
+                     ackBytes += writePacket(id) * extSize;
+                  else
+                  {
+                     CDC_Device_SendByte(&VirtualSerial_CDC_Interface, mid);
+                     CDC_Device_SendByte(&VirtualSerial_CDC_Interface, high);
+                  }
+                  size = 0;
+                  if (id == 'V')
+                  {
+                     XilinxReset();
+                     appState = APP_FPGA_CONFIGURE;
+                  }
+                  else if (id == 'S')
+                  {
+                     endless = (extSize == 0);
+                     appState = APP_UCIF_DDR_STREAM;
+                  }
+                  else if (!nextChunk(&size, &extSize))
+                     appState = APP_WAIT_FOR_PACKET_ID;
+                  else if (id == 'X')
+                     appState = APP_UCIF_DDR_WR;
+                  else
+                     appState = APP_UCIF_DDR_RD;
+               }
+               break;
+            case APP_FPGA_CONFIGURE:
+               {
+                  uint8_t *data;
+                  uint8_t ready = ringPeekContiguous(&inBuffer, &data);
+
+                  if (ready > extSize)
+                     ready = (uint8_t)extSize;
+                  XilinxWriteBlock(data, ready);
+                  ringConsumeN(&inBuffer, ready);
+                  extSize -= ready;
+                  if (extSize == 0)
+                  {
+                     uint8_t result = XilinxFinishConfig();
+
+                     CDC_Device_SendByte(&VirtualSerial_CDC_Interface, result);
+                     if (result != XILINX_CFG_SUCCESS)
+                     {
+                        // Back to the console, just like after '#R'.
+                        CDC_Device_Flush(&VirtualSerial_CDC_Interface);
+                        *cfgKeyPtr = (uint16_t)0x1234;
+                        return;
+                     }
+                     // The new design starts from scratch.
+                     ucifBaseInit();
+#if defined(SHADOW_SIZE)
+                     shadowReset();
+#endif
+#if defined(ATTENTION_EVENTS)
+                     attention = 0;
+#endif
+#if defined(AUTORUN_MACRO)
+                     macroRun(AUTORUN_MACRO);
+#endif
+                     appState = APP_WAIT_FOR_PACKET_ID;
+                  }
+               }
+               break;
+            case APP_WAIT_FOR_BASE_ADDRESS:
+               if (ringCount(&inBuffer) > 0)
+               {
+                  address = ringRemove(&inBuffer);
+                  appState = (id == 'b') ? APP_UCIF_BURST_WR : APP_UCIF_BURST_RD;
+               }
+               break;
+            case APP_UCIF_BURST_WR:
+               {
+                  uint8_t *data;
+                  uint8_t ready = ringPeekContiguous(&inBuffer, &data);
+
+                  if (ready > size)
+                     ready = size;
                   UCIF_RW_CLR;
                   UCIF_AS_OUTPUT;
-                  UCIF_DATA_PORT = RingBuffer_Remove(&inBuffer);
-                  UCIF_E_SET;
+                  for (uint8_t n = ready; n > 0; n--)
+                  {
+#if defined(SHADOW_SIZE)
+                     shadowStore(address, *data);
+#endif
+                     UCIF_DATA_PORT = address++;
+                     UCIF_E_SET;
+                     UCIF_DATA_PORT = *data++;
+                     UCIF_E_CLR;
+                  }
+                  ringConsumeN(&inBuffer, ready);
+                  size -= ready;
+                  if (size == 0)
+                     appState = APP_WAIT_FOR_PACKET_ID;
+               }
+               break;
+            case APP_UCIF_MODIFY:
+               {
+                  // The read and the write back happen without any USB
+                  // transfer in between, so the host sees them atomic.
+                  uint8_t entry = (id == UCIF_OP_MASKED) ? 3 : 2;
+
+                  while ((size > 0) && (ringCount(&inBuffer) >= entry))
+                  {
+                     uint8_t reg = ringRemove(&inBuffer);
+                     uint8_t mask = ringRemove(&inBuffer);
+                     uint8_t value = (id == UCIF_OP_MASKED) ? ringRemove(&inBuffer) : 0;
+
+                     ucifModify(id, reg, mask, value);
+#if defined(SHADOW_SIZE)
+                     shadowForget(reg);
+#endif
+                     size--;
+                  }
+                  if (size == 0)
+                     appState = APP_WAIT_FOR_PACKET_ID;
+               }
+               break;
+            case APP_UCIF_WIDE_WR:
+               while ((size > 0) && (ringCount(&inBuffer) >= 3))
+               {
+                  uint16_t reg = (uint16_t)ringRemove(&inBuffer) << 8;
+
+                  reg |= ringRemove(&inBuffer);
+#if defined(SHADOW_SIZE)
+                  // The lowest 256 registers are reachable either way.
+                  if (reg < 256)
+                     shadowForget(reg);
+#endif
+                  ucifWideWrite(reg, ringRemove(&inBuffer));
+                  size--;
+               }
+               if (size == 0)
+                  appState = APP_WAIT_FOR_PACKET_ID;
+               break;
+            case APP_UCIF_WIDE_RD:
+               while ((size > 0) && (ringCount(&inBuffer) >= 2))
+               {
+                  uint16_t reg = (uint16_t)ringRemove(&inBuffer) << 8;
+
+                  reg |= ringRemove(&inBuffer);
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, ucifWideRead(reg));
+                  size--;
+               }
+               if (size == 0)
+                  appState = APP_WAIT_FOR_PACKET_ID;
+               break;
+            case APP_WAIT_FOR_POLL_SETUP:
+               if (ringCount(&inBuffer) >= 5)
+               {
+                  uint8_t reg = ringRemove(&inBuffer);
+                  uint8_t mask = ringRemove(&inBuffer);
+                  uint8_t value = ringRemove(&inBuffer);
+                  uint8_t interval = ringRemove(&inBuffer);
+                  uint8_t timeout = ringRemove(&inBuffer);
+
+                  ucifPollStart(reg, mask, value, interval, timeout);
+                  appState = APP_UCIF_POLL;
+               }
+               break;
+            case APP_UCIF_POLL:
+               // Packets received meanwhile wait in the ring.
+               if (ucifPollStep())
+                  appState = APP_WAIT_FOR_PACKET_ID;
+               break;
+            case APP_WAIT_FOR_SAMPLE_PERIOD:
+               if (ringCount(&inBuffer) > 1)
+               {
+                  period = ringRemove(&inBuffer);
+                  period |= (uint16_t)ringRemove(&inBuffer) << 8;
+                  appState = APP_SAMPLE_REGISTERS;
+               }
+               break;
+            case APP_SAMPLE_REGISTERS:
+               while ((size > 0) && (ringCount(&inBuffer) > 0))
+               {
+                  uint8_t reg = ringRemove(&inBuffer);
+
+                  if (sampleCount < SAMPLE_REGS)
+                     sampleRegs[sampleCount++] = reg;
+                  size--;
+               }
+               if (size == 0)
+               {
+                  if ((sampleCount > 0) && (period > 0))
+                  {
+                     sampleStart(period);
+                     appState = APP_UCIF_SAMPLE;
+                  }
+                  else
+                     appState = APP_WAIT_FOR_PACKET_ID;
+               }
+               break;
+            case APP_UCIF_SAMPLE:
+               // Any packet received stops sampling, it gets processed as
+               // usual afterwards.
+               if (ringCount(&inBuffer) > 0)
+               {
+                  sampleStop();
+                  appState = APP_WAIT_FOR_PACKET_ID;
+               }
+               else
+               {
+                  samplePause();
+                  while (ringCount(&sampleRing) > sampleCount)
+                  {
+                     CDC_Device_SendByte(&VirtualSerial_CDC_Interface, 'P');
+                     CDC_Device_SendByte(&VirtualSerial_CDC_Interface, sampleCount);
+                     for (uint8_t n = sampleCount + 1; n > 0; n--)
+                        CDC_Device_SendByte(&VirtualSerial_CDC_Interface, ringRemove(&sampleRing));
+                  }
+                  sampleResume();
+               }
+               break;
+            case APP_WAIT_FOR_CAPTURE_SETUP:
+               if (ringCount(&inBuffer) >= 5)
+               {
+                  address = ringRemove(&inBuffer);
+                  capMask = ringRemove(&inBuffer);
+                  capValue = ringRemove(&inBuffer);
+                  capPost = ringRemove(&inBuffer);
+                  capPost |= (uint16_t)ringRemove(&inBuffer) << 8;
+                  if ((size == 1) || (size == 2))
+                  {
+                     // The trigger sample itself stays inside the window.
+                     if (capPost >= (sizeof(aBuffer) / size))
+                        capPost = (sizeof(aBuffer) / size) - 1;
+                     capLeft = capPost * size;
+                     capPos = 0;
+                     capFilled = 0;
+                     capTriggered = 0;
+                     appState = APP_UCIF_CAPTURE;
+                  }
+                  else
+                  {
+                     ackFlags |= ACK_FLAG_UNKNOWN;
+                     appState = APP_WAIT_FOR_PACKET_ID;
+                  }
+               }
+               break;
+            case APP_UCIF_CAPTURE:
+               // The console takes over 'aBuffer' when it starts a job on
+               // FLASH or FPGA, the loop is left then anyway.
+               if (ringCount(&inBuffer) > 0)
+               {
+                  // Any packet received aborts, the window reads as empty.
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, 0);
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, 0);
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, 0);
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, 0);
+                  appState = APP_WAIT_FOR_PACKET_ID;
+                  break;
+               }
+               if (size == 2)
+               {
+                  UCIF_DDR_SET;
                   UCIF_AS_INPUT;
                   UCIF_RW_SET;
-                  UCIF_E_CLR;
-                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, UCIF_DATA_RET);
-                  ready--;
+               }
+               for (uint8_t n = CAPTURE_BURST; n > 0; n--)
+               {
+                  uint8_t *data = &aBuffer[capPos];
+
+                  if (size == 1)
+                     data[0] = ucifRead(address);
+                  else
+                  {
+                     data[0] = UCIF_DATA_RET;
+                     UCIF_E_SET;
+                     data[1] = UCIF_DATA_RET;
+                     UCIF_E_CLR;
+                  }
+                  capPos += size;
+                  if (capPos >= sizeof(aBuffer))
+                     capPos = 0;
+                  if (capFilled < sizeof(aBuffer))
+                     capFilled += size;
+                  if (capTriggered)
+                     capLeft -= size;
+                  else if ((data[0] & capMask) == capValue)
+                     capTriggered = 1;
+                  if (capTriggered && (capLeft == 0))
+                     break;
+               }
+               if (capTriggered && (capLeft == 0))
+               {
+                  // The window ends at 'capPos', the oldest sample follows
+                  // it once the buffer got filled.
+                  uint16_t count = capFilled / size;
+                  uint16_t start = (capFilled < sizeof(aBuffer)) ? 0 : capPos;
+
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, count & 0xFF);
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, count >> 8);
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, (count - 1 - capPost) & 0xFF);
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, (count - 1 - capPost) >> 8);
+                  CDC_Device_SendData(&VirtualSerial_CDC_Interface, &aBuffer[start], capFilled - start);
+                  if (start != 0)
+                     CDC_Device_SendData(&VirtualSerial_CDC_Interface, aBuffer, start);
+                  appState = APP_WAIT_FOR_PACKET_ID;
+               }
+               break;
+            case APP_WAIT_FOR_MACRO_SLOT:
+               if ((ringCount(&inBuffer) > 0) && macroReady())
+               {
+                  macro = ringRemove(&inBuffer);
+                  if (macro < MACRO_SLOTS)
+                     macroBegin(macro);
+                  else
+                     ackFlags |= ACK_FLAG_UNKNOWN;
+                  appState = APP_MACRO_RECORD;
+               }
+               break;
+            case APP_MACRO_RECORD:
+               // One byte per EEPROM write cycle (3.4 ms), the host gets
+               // throttled by the ring running full meanwhile.
+               if ((size > 0) && (ringCount(&inBuffer) > 0) && macroReady())
+               {
+                  uint8_t data = ringRemove(&inBuffer);
+
+                  if (macro < MACRO_SLOTS)
+                     macroAppend(data);
                   size--;
                }
-               if (size == 0)
+               if ((size == 0) && macroReady())
+               {
+                  if (macro < MACRO_SLOTS)
+                     macroEnd();
                   appState = APP_WAIT_FOR_PACKET_ID;
-            }
-            break;
-         case APP_UCIF_DDR_RD:
-            {
-               UCIF_AS_INPUT;
-               UCIF_RW_SET;
-               while (size > 0)
-               {
-                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, UCIF_DATA_RET);
-                  UCIF_E_SET;
-                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, UCIF_DATA_RET);
-                  UCIF_E_CLR;
+               }
+               break;
+            case APP_UCIF_BURST_RD:
+               cdcSendBurst(address, size);
+               size = 0;
+               appState = APP_WAIT_FOR_PACKET_ID;
+               break;
+#if defined(SHADOW_SIZE)
+            case APP_UCIF_SDR_WR:
+               while ((size > 0) && (ringCount(&inBuffer) > 1))
+               {
+                  uint8_t reg = ringRemove(&inBuffer);
+                  uint8_t data = ringRemove(&inBuffer);
+
+                  if (shadowWrite(reg, data))
+                     ucifWrite(reg, data);
+                  else if (size == 1)
+                     ucifAddress(reg);    // DDR packets use the last address
                   size--;
                }
                if (size == 0)
                   appState = APP_WAIT_FOR_PACKET_ID;
-            }
-            break;
-         default:
-            ;
+               break;
+#else
+            case APP_UCIF_SDR_WR:
+#endif
+            case APP_UCIF_DDR_WR:
+               {
+                  if (appState == APP_UCIF_DDR_WR)
+                     UCIF_DDR_SET;
+                  else
+                     UCIF_DDR_CLR;
+                  UCIF_RW_CLR;
+                  UCIF_AS_OUTPUT;
+                  while (size > 0)
+                  {
+                     uint8_t *data;
+                     uint8_t words = ringPeekContiguous(&inBuffer, &data) / 2;
+
+                     if (words > size)
+                        words = size;
+                     if (words == 0)
+                     {
+                        // Just a word wrapping around the end of the ring.
+                        if (ringCount(&inBuffer) < 2)
+                           break;
+                        UCIF_DATA_PORT = ringRemove(&inBuffer);
+                        UCIF_E_SET;
+                        UCIF_DATA_PORT = ringRemove(&inBuffer);
+                        UCIF_E_CLR;
+                        size--;
+                        continue;
+                     }
+                     ucifKernelWrite(data, words);
+                     ringConsumeN(&inBuffer, 2 * words);
+                     size -= words;
+                  }
+                  if ((size > 0) && (ringCount(&inBuffer) == 0) && !framed)
+                     size = cdcWriteThrough(&inBuffer, size);
+                  if ((size == 0) && !nextChunk(&size, &extSize))
+                     appState = APP_WAIT_FOR_PACKET_ID;
+               }
+               break;
+            case APP_UCIF_SDR_RD:
+               {
+                  uint8_t *data;
+                  uint8_t ready = ringPeekContiguous(&inBuffer, &data);
+
+                  if (ready > size)
+                     ready = size;
+                  cdcSendSDR(data, ready);
+                  ringConsumeN(&inBuffer, ready);
+                  size -= ready;
+                  if (size == 0)
+                     appState = APP_WAIT_FOR_PACKET_ID;
+               }
+               break;
+            case APP_UCIF_DDR_RD:
+               {
+                  UCIF_DDR_SET;
+                  UCIF_AS_INPUT;
+                  UCIF_RW_SET;
+                  cdcSendDDR(size);
+                  size = 0;
+                  if (!nextChunk(&size, &extSize))
+                     appState = APP_WAIT_FOR_PACKET_ID;
+               }
+               break;
+            case APP_UCIF_DDR_STREAM:
+               // Any packet received stops the stream, it gets processed as
+               // usual afterwards.
+               if (ringCount(&inBuffer) > 0)
+               {
+                  extSize = 0;
+                  appState = APP_WAIT_FOR_PACKET_ID;
+               }
+               else
+               {
+                  if (endless)
+                     size = APP_CHUNK_WORDS;
+                  else if (!nextChunk(&size, &extSize))
+                  {
+                     appState = APP_WAIT_FOR_PACKET_ID;
+                     break;
+                  }
+                  // Each chunk is framed like the answer to a DDR-RD packet.
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, 'S');
+                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, size);
+                  UCIF_DDR_SET;
+                  UCIF_AS_INPUT;
+                  UCIF_RW_SET;
+                  cdcSendDDR(size);
+                  size = 0;
+               }
+               break;
+            case APP_SET_OPTIONS:
+               {
+                  uint8_t ready = ringCount(&inBuffer);
+                  while ((ready > 1) && (size > 0))
+                  {
+                     uint8_t option = ringRemove(&inBuffer);
+                     uint8_t value = ringRemove(&inBuffer);
+                     switch (option)
+                     {
+                        case OPT_FLUSH_TIMEOUT:
+                           flushTimeout = value;
+                           break;
+                        case OPT_FRAMING:
+                           framing = value;
+                           break;
+                        case OPT_EVENT_BASE:
+                           eventBase = value;
+                           break;
+                        case OPT_EVENT_COUNT:
+                           eventCount = value;
+                           break;
+#if defined(SHADOW_SIZE)
+                        case OPT_SHADOW_STATIC:
+                           shadowDeclare(value, 1);
+                           break;
+                        case OPT_SHADOW_VOLATILE:
+                           shadowDeclare(value, 0);
+                           break;
+#endif
+                        case OPT_WRITE_ACK:
+                           // Counting restarts with the new setting.
+                           ackInterval = value;
+                           ackCountdown = value;
+                           ackPackets = 0;
+                           ackBytes = 0;
+                           ackFlags = 0;
+                           break;
+                        default:
+                           ;
+                     }
+                     ready -= 2;
+                     size--;
+                  }
+                  if (size == 0)
+                  {
+                     // The framing changes with the next packet.
+                     if (framing && !framed)
+                     {
+                        // Anything received so far still needs a check, it
+                        // goes back from 'inBuffer' to 'rawBuffer'.
+                        rawBuffer = inBuffer;
+                        ringInsertN(&inBuffer, (uint8_t)(inBuffer.tail - inBuffer.head));
+                        frameSeq = 0;
+                        frameNakSent = 0;
+                        frameNakReason = 0;
+                     }
+                     else if (!framing && framed)
+                     {
+                        // Bytes received behind the frame were sent before
+                        // the host got the echo, they still belong to the
+                        // framed stream. They are dropped unchecked, the
+                        // space of 'rawBuffer' behind 'inBuffer' gets
+                        // reused by the plain packets.
+                        frameNakReason = 0;
+                     }
+                     framed = framing;
+                     appState = APP_WAIT_FOR_PACKET_ID;
+                  }
+               }
+               break;
+            default:
+               ;
+         }
+      } while ((appState != prevState) || (ringCount(&inBuffer) != prevCount));
+
+      // Full IN packets are sent by the CDC driver on its own. Anything less
+      // waits here until the request burst is done or the timeout expires.
+      if ((flushTimeout == 0) ||
+          ((appState == APP_WAIT_FOR_PACKET_ID) && (ringCount(&inBuffer) == 0)) ||
+          ((uint8_t)(frameCount - flushFrame) >= flushTimeout))
+      {
+         CDC_Device_Flush(&VirtualSerial_CDC_Interface);
+         flushFrame = frameCount;
+      }
+   }
+}
+
+
+uint8_t cdcReceive(ring_t *const ring)
+{
+   // Same conditions as with CDC_Device_BytesReceived()
+   if ((USB_DeviceState != DEVICE_STATE_Configured) ||
+       !VirtualSerial_CDC_Interface.State.LineEncoding.BaudRateBPS)
+      return(0);
+
+   uint8_t prevEndpoint = Endpoint_GetCurrentEndpoint();
+   uint8_t count = 0;
+
+   Endpoint_SelectEndpoint(VirtualSerial_CDC_Interface.Config.DataOUTEndpoint.Address);
+   if (Endpoint_IsOUTReceived())
+   {
+      uint8_t *data;
+      uint8_t space = ringReserveContiguous(ring, &data);
+      uint8_t avail = Endpoint_BytesInEndpoint();
+
+      count = (avail < space) ? avail : space;
+      for (uint8_t n = count; n > 0; n--)
+         *data++ = Endpoint_Read_8();
+      ringInsertN(ring, count);
+      // The bank gets released as soon as it is read completely, a zero
+      // length packet included.
+      if (avail == count)
+         Endpoint_ClearOUT();
+   }
+   Endpoint_SelectEndpoint(prevEndpoint);
+   return(count);
+}
+
+
+void ucifPollStart(uint8_t address, uint8_t mask, uint8_t value, uint8_t interval, uint8_t timeout)
+{
+   pollAddress = address;
+   pollMask = mask;
+   pollValue = value;
+   // Timer1 counts F_CPU/64, 8 s per tick at 8 MHz.
+   pollLimit = timeout * (uint16_t)(F_CPU / 64000UL);
+   pollStep = ((uint32_t)interval * (F_CPU / 1000000UL) + 63) / 64;
+   pollNext = 0;
+   pollTimerControl = TCCR1B;
+   pollTimerCount = TCNT1;
+   TCCR1B = 0;
+   TCNT1  = 0;
+   TCCR1B = (1 << CS11) | (1 << CS10);
+}
+
+
+uint8_t ucifPollStep(void)
+{
+   uint16_t now = TCNT1;
+
+   if (now < pollNext)
+      return(0);
+
+   uint8_t data = ucifRead(pollAddress);
+   uint8_t met = ((data & pollMask) == pollValue);
+
+   if (!met && (now < pollLimit))
+   {
+      pollNext += pollStep;
+      return(0);
+   }
+   TCCR1B = 0;
+   TCNT1  = pollTimerCount;
+   TCCR1B = pollTimerControl;
+
+   uint32_t elapsed = ((uint32_t)now * 64) / (F_CPU / 1000000UL);
+
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, data);
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, met);
+   for (uint8_t n = 3; n > 0; n--)
+   {
+      CDC_Device_SendByte(&VirtualSerial_CDC_Interface, (uint8_t)elapsed);
+      elapsed >>= 8;
+   }
+   return(1);
+}
+
+
+void cdcSendAck(uint16_t packets, uint32_t bytes, uint8_t flags)
+{
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, 'a');
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, 7);
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, (uint8_t)packets);
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, (uint8_t)(packets >> 8));
+   for (uint8_t n = 4; n > 0; n--)
+   {
+      CDC_Device_SendByte(&VirtualSerial_CDC_Interface, (uint8_t)bytes);
+      bytes >>= 8;
+   }
+   CDC_Device_SendByte(&VirtualSerial_CDC_Interface, flags);
+}
+
+
+uint8_t cdcWriteThrough(ring_t *const ring, uint8_t words)
+{
+   if ((USB_DeviceState != DEVICE_STATE_Configured) ||
+       !VirtualSerial_CDC_Interface.State.LineEncoding.BaudRateBPS)
+      return(words);
+
+   uint8_t prevEndpoint = Endpoint_GetCurrentEndpoint();
+
+   Endpoint_SelectEndpoint(VirtualSerial_CDC_Interface.Config.DataOUTEndpoint.Address);
+   while ((words > 0) && Endpoint_IsOUTReceived())
+   {
+      uint8_t avail = Endpoint_BytesInEndpoint();
+      uint8_t pairs = avail / 2;
+
+      if (pairs > words)
+         pairs = words;
+      words -= pairs;
+      avail -= 2 * pairs;
+      ucifKernelWriteFifo(&UEDATX, pairs);
+      if (avail == 0)
+         Endpoint_ClearOUT();
+      else
+      {
+         // Either the next packet starts here or a word continues in the
+         // next bank. The ring takes the odd byte then, the application
+         // loop fetches the next bank into the ring and completes the word.
+         if (words > 0)
+         {
+            ringInsert(ring, Endpoint_Read_8());
+            Endpoint_ClearOUT();
+         }
+         break;
+      }
+   }
+   Endpoint_SelectEndpoint(prevEndpoint);
+   return(words);
+}
+
+
+/**
+ *  \~English
+ *   Writes one byte into the selected IN endpoint. A full bank is handed
+ *   over to the host first, so banks get switched at CDC_TXRX_EPSIZE bytes
+ *   only. Just like CDC_Device_SendByte() a full bank stays in place until
+ *   the next byte or the flush policy of the 'applicationLoop'.
+ *   @return '0' if the host does not fetch data, the byte is lost then and
+ *   the caller stops sending the answer.
+ *
+ *  \~German
+ *   Schreibt ein Byte in den ausgewhlten IN-Endpunkt. Eine volle Bank wird
+ *   zuerst an den Host bergeben, die Banken werden also nur nach
+ *   CDC_TXRX_EPSIZE Bytes gewechselt. Wie bei CDC_Device_SendByte() bleibt
+ *   eine volle Bank bis zum nchsten Byte oder bis zum Absenden durch die
+ *   'applicationLoop' liegen.
+ *   @return '0' wenn der Host keine Daten abholt, das Byte ist dann
+ *   verloren und der Aufrufer sendet die Antwort nicht weiter.
+ */
+static inline uint8_t cdcPut(const uint8_t data)
+{
+   if (!Endpoint_IsReadWriteAllowed())
+   {
+      Endpoint_ClearIN();
+      if (Endpoint_WaitUntilReady() != ENDPOINT_READYWAIT_NoError)
+         return(0);
+   }
+   Endpoint_Write_8(data);
+   return(1);
+}
+
+
+/**
+ *  \~English
+ *   Tells how many bytes fit into the bank of the selected IN endpoint. A
+ *   full bank is handed over to the host first, just like by cdcPut().
+ *   @return Free bytes in the bank, '0' if the host does not fetch data.
+ *
+ *  \~German
+ *   Gibt an, wie viele Bytes in die Bank des ausgewhlten IN-Endpunkts
+ *   passen. Eine volle Bank wird zuerst an den Host bergeben, genau wie
+ *   bei cdcPut().
+ *   @return Freie Bytes in der Bank, '0' wenn der Host keine Daten abholt.
+ */
+static inline uint8_t cdcSpace(void)
+{
+   if (!Endpoint_IsReadWriteAllowed())
+   {
+      Endpoint_ClearIN();
+      if (Endpoint_WaitUntilReady() != ENDPOINT_READYWAIT_NoError)
+         return(0);
+   }
+   return(CDC_TXRX_EPSIZE - (uint8_t)Endpoint_BytesInEndpoint());
+}
+
+
+void cdcSendSDR(const uint8_t *address, uint8_t count)
+{
+   uint8_t prevEndpoint = Endpoint_GetCurrentEndpoint();
+   uint8_t online = (USB_DeviceState == DEVICE_STATE_Configured) &&
+                    VirtualSerial_CDC_Interface.State.LineEncoding.BaudRateBPS;
+
+   Endpoint_SelectEndpoint(VirtualSerial_CDC_Interface.Config.DataINEndpoint.Address);
+#if defined(SHADOW_SIZE)
+   for (; count > 0; count--)
+   {
+      uint8_t reg = *address++;
+      uint8_t data;
+
+      if (!shadowRead(reg, &data))
+      {
+         UCIF_RW_CLR;
+         UCIF_AS_OUTPUT;
+         UCIF_DATA_PORT = reg;
+         UCIF_E_SET;
+         UCIF_AS_INPUT;
+         UCIF_RW_SET;
+         UCIF_E_CLR;
+         data = UCIF_DATA_RET;
+         shadowStore(reg, data);
+      }
+      else if (count == 1)
+         ucifAddress(reg);    // DDR packets use the last address
+      // Without a host the accesses get done anyway, the FPGA logic
+      // might depend on them.
+      if (online)
+         online = cdcPut(data);
+   }
+#else
+   UCIF_AS_INPUT;
+   UCIF_RW_SET;
+   while (count > 0)
+   {
+      uint8_t space = online ? cdcSpace() : 0;
+
+      if (space == 0)
+      {
+         // Without a host the accesses get done anyway, the FPGA logic
+         // might depend on them.
+         volatile uint8_t sink;
+
+         ucifKernelSdrRead(address, count, &sink);
+         break;
       }
-      CDC_Device_Flush(&VirtualSerial_CDC_Interface);
+      if (space > count)
+         space = count;
+      ucifKernelSdrRead(address, space, &UEDATX);
+      address += space;
+      count -= space;
    }
+#endif
+   Endpoint_SelectEndpoint(prevEndpoint);
 }
 
 
-void commandLineInterface(void)
+void cdcSendBurst(uint8_t address, uint8_t count)
+{
+   uint8_t prevEndpoint = Endpoint_GetCurrentEndpoint();
+   uint8_t online = (USB_DeviceState == DEVICE_STATE_Configured) &&
+                    VirtualSerial_CDC_Interface.State.LineEncoding.BaudRateBPS;
+
+   Endpoint_SelectEndpoint(VirtualSerial_CDC_Interface.Config.DataINEndpoint.Address);
+   for (; count > 0; count--)
+   {
+      UCIF_RW_CLR;
+      UCIF_AS_OUTPUT;
+      UCIF_DATA_PORT = address++;
+      UCIF_E_SET;
+      UCIF_AS_INPUT;
+      UCIF_RW_SET;
+      UCIF_E_CLR;
+      if (online)
+         online = cdcPut(UCIF_DATA_RET);
+   }
+   Endpoint_SelectEndpoint(prevEndpoint);
+}
+
+
+void cdcSendDDR(uint8_t words)
+{
+   uint8_t prevEndpoint = Endpoint_GetCurrentEndpoint();
+   uint8_t online = (USB_DeviceState == DEVICE_STATE_Configured) &&
+                    VirtualSerial_CDC_Interface.State.LineEncoding.BaudRateBPS;
+
+   Endpoint_SelectEndpoint(VirtualSerial_CDC_Interface.Config.DataINEndpoint.Address);
+   while (words > 0)
+   {
+      uint8_t space = online ? cdcSpace() : 0;
+
+      if (space == 0)
+      {
+         // Without a host the accesses get done anyway, the FPGA logic
+         // might depend on them.
+         volatile uint8_t sink;
+
+         ucifKernelDdrRead(words, &sink);
+         break;
+      }
+      if (space == 1)
+      {
+         // Just a word wrapping around the end of the bank. A failed put
+         // ends the answer, the bus cycle gets finished anyway.
+         online = cdcPut(UCIF_DATA_RET);
+         UCIF_E_SET;
+         if (online)
+            online = cdcPut(UCIF_DATA_RET);
+         UCIF_E_CLR;
+         words--;
+         continue;
+      }
+      space /= 2;
+      if (space > words)
+         space = words;
+      ucifKernelDdrRead(space, &UEDATX);
+      words -= space;
+   }
+   Endpoint_SelectEndpoint(prevEndpoint);
+}
+
+
+#if defined(HID_LINK)
+void hidTransaction(void)
 {
-   uint8_t  cliState;
-   uint8_t  cfgSrc = 0;
-   uint32_t flashAddr = 0;
-   uint32_t fileSize = 0;
-   uint8_t  aBuffer[1800]; // at least max(4*CDC_TXRX_EPSIZE, 256)
+   uint8_t  id = hidRequest[0];
+   uint8_t  size = hidRequest[1];
+   uint8_t* data = &hidRequest[2];
+
+   memset(hidAnswer, 0, sizeof(hidAnswer));
+#if defined(SHADOW_SIZE)
+   // HID writes bypass the shadow.
+   shadowInvalidate();
+#endif
+   switch (id)
+   {
+      case 'w':   // SDR-WR packet
+         if (size > (HID_REPORT_SIZE - 2) / 2)
+            size = (HID_REPORT_SIZE - 2) / 2;
+         UCIF_DDR_CLR;
+         UCIF_RW_CLR;
+         UCIF_AS_OUTPUT;
+         ucifKernelWrite(data, size);
+         break;
+      case 'r':   // SDR-RD packet
+         if (size > (HID_REPORT_SIZE - 2))
+            size = HID_REPORT_SIZE - 2;
+         UCIF_DDR_CLR;
+         for (uint8_t n = 0; n < size; n++)
+         {
+            UCIF_RW_CLR;
+            UCIF_AS_OUTPUT;
+            UCIF_DATA_PORT = data[n];
+            UCIF_E_SET;
+            UCIF_AS_INPUT;
+            UCIF_RW_SET;
+            UCIF_E_CLR;
+            hidAnswer[2 + n] = UCIF_DATA_RET;
+         }
+         break;
+      default:    // not supported by the HID, tell by a zero length
+         size = 0;
+   }
+   hidAnswer[0] = id;
+   hidAnswer[1] = size;
+   hidRequestPending = 0;
+   hidAnswerPending = 1;
+}
+#endif
+
 
-   if (*cfgKeyPtr != 0x1234)
+void commandLineInterface(void)
+{
+   if (!commandLineBusy()) // else the console already started a job
    {
-      cfgSrc = CFG_SRC_SPI;
-      cliState = CLI_XILINX_TRIGGER_CONFIG;
+      if (*cfgKeyPtr != 0x1234)
+      {
+         cfgSrc = CFG_SRC_SPI;
+         cliState = CLI_XILINX_TRIGGER_CONFIG;
+      }
+      else
+         cliState = CLI_WAIT_FOR_CONNECT;
    }
-   else
-      cliState = CLI_WAIT_FOR_CONNECT;
 
    for (;;)
    {
-      CDC_Device_USBTask(&VirtualSerial_CDC_Interface);
+      CDC_Device_USBTask(&CONSOLE_INTERFACE);
       USB_USBTask();
-      switch (cliState)
+#if defined(MSC_DRIVE)
+      // FLASH and FPGA are left alone while a bitstream is processed.
+      if (!commandLineBusy())
       {
-         case CLI_WAIT_FOR_CONNECT:
-            if (CDC_Device_BytesReceived(&VirtualSerial_CDC_Interface) != 0)
+         MS_Device_USBTask(&Flash_MS_Interface);
+         if (mscNewBitstream())
+         {
+            cfgSrc = CFG_SRC_SPI;
+            cliState = CLI_XILINX_TRIGGER_CONFIG;
+         }
+      }
+#endif
+      if (commandLineTask())
+         return;  // it is time to start the user application code
+   }
+}
+
+
+uint8_t commandLineBusy(void)
+{
+   return(cliState > CLI_LISTEN);
+}
+
+
+uint8_t commandLineTask(void)
+{
+   switch (cliState)
+   {
+      case CLI_WAIT_FOR_CONNECT:
+         if (CDC_Device_BytesReceived(&CONSOLE_INTERFACE) != 0)
+         {
+#if defined(STARTUP_TIMING)
+            startupStamp(STARTUP_FIRST_BYTE);
+#endif
+            CDC_Device_ReceiveByte(&CONSOLE_INTERFACE);
+            p(greetStr);
+            cliState = CLI_HELP;
+         }
+         break;
+      case CLI_HELP:
+         p(helpStr);
+         // There is intentionally no `break;` here!
+      case CLI_FLASH_INFO: ;
+         {
+            char* ptr = 0;
+
+            if (getFlashChipID() != ID_MICROCHIP)
+               p(wrongStr);
+            readFlash(aBuffer, 0, sizeof(aBuffer));
+            ptr = XilinxGetHeaderField(aBuffer, XILINX_FIELD_DESIGN);
+            if (ptr != 0)
             {
-               CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
-               p(greetStr);
-               cliState = CLI_HELP;
+               p(PSTR("\r\n"));
+               fputs(ptr, &USBSerialStream);
             }
-            break;
-         case CLI_HELP:
-            p(helpStr);
-            // There is intentionally no `break;` here!
-         case CLI_FLASH_INFO: ;
+            else
+               p(emptyStr);
+         }
+         // There is intentionally no `break;` here!
+      case CLI_PROMPT:
+         p(promptStr);
+         cliState = CLI_LISTEN;
+         // There is intentionally no `break;` here!
+      case CLI_LISTEN:
+         {
+            uint8_t rxCount = CDC_Device_BytesReceived(&CONSOLE_INTERFACE);
+            if (rxCount == 1)
             {
-               char* ptr = 0;
-
-               if (getFlashChipID() != ID_MICROCHIP)
-                  p(wrongStr);
-               readFlash(aBuffer, 0, sizeof(aBuffer));
-               ptr = XilinxGetHeaderField(aBuffer, XILINX_FIELD_DESIGN);
-               if (ptr != 0)
+               cliState = CLI_PROMPT;
+               uint8_t cmdChar = CDC_Device_ReceiveByte(&CONSOLE_INTERFACE);
+               CDC_Device_SendByte(&CONSOLE_INTERFACE, cmdChar);
+               switch (cmdChar)
                {
-                  p(PSTR("\r\n"));
-                  fputs(ptr, &USBSerialStream);
+                  case '\r':
+                  case '\n':
+                     break;
+                  case '?':   // 'manpage'
+                     cliState = CLI_HELP;
+                     break;
+                  case 'i':   // return bitstream header info from FLASH
+                     cliState = CLI_FLASH_INFO;
+                     break;
+                  case 's':   // return FPGA state
+                     if (XilinxConfigured())
+                        p(configdStr);
+                     else
+                        p(blankStr);
+                     break;
+                  case 'V':   // feed bitstream volatile into FPGA
+                     cfgSrc = CFG_SRC_USB;
+                     p(needStr);
+                     cliState = CLI_XILINX_TRIGGER_CONFIG;
+                     break;
+                  case 'C':   // configure from recent SPI-FLASH content
+                     cfgSrc = CFG_SRC_SPI;
+                     p(PSTR("\r\n"));
+                     cliState = CLI_XILINX_TRIGGER_CONFIG;
+                     break;
+                  case 'W':   // store bitstream non-volatile into SPI-FLASH
+                     eraseFlash();
+                     p(needStr);
+                     flashAddr = 0;
+                     fileSize = 0;
+                     cliState = CLI_STORE_BITSTREAM_INTRO;
+                     break;
+/*
+                  case 'v':   // verify FLASH data
+                     p(needStr);
+                     flashAddr = 0;
+                     cliState = CLI_VERIFY_FLASH;
+                     break;
+*/
+#if defined(STARTUP_TIMING)
+                  case 't':   // report startup timing
+                     startupReport();
+                     break;
+#endif
+#if defined(UCIF_BENCHMARK)
+                  case 'b':   // measure the UCIF read kernels
+                  case 'B':   // measure all UCIF kernels, writes included
+                     if (XilinxConfigured())
+                        ucifBenchmark(cmdChar == 'B');
+                     else
+                        p(blankStr);
+                     break;
+#endif
+                  case 'E':   // erase FLASH
+                     eraseFlash();
+#if defined(MSC_DRIVE)
+                     mscScanFlash();
+#endif
+                     break;
+                  default:
+                     p(unknownStr);
                }
-               else
-                  p(emptyStr);
             }
-            // There is intentionally no `break;` here!
-         case CLI_PROMPT:
-            p(promptStr);
-            cliState = CLI_LISTEN;
-            // There is intentionally no `break;` here!
-         case CLI_LISTEN:
-            {
-               uint8_t rxCount = CDC_Device_BytesReceived(&VirtualSerial_CDC_Interface);
-               if (rxCount == 1)
+            else
+               for (uint8_t n = rxCount; n > 0; n--)
+                  CDC_Device_ReceiveByte(&CONSOLE_INTERFACE);
+         }
+         break;
+      case CLI_XILINX_TRIGGER_CONFIG:
+         flashAddr = 0;
+         fileSize = 0;
+         cliState = CLI_XILINX_CONFIGURE_INTRO;
+         // There is intentionally no `break;` here!
+      case CLI_XILINX_CONFIGURE_INTRO:
+         switch (cfgSrc)
+         {
+            case CFG_SRC_USB:
                {
-                  cliState = CLI_PROMPT;
-                  uint8_t cmdChar = CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
-                  CDC_Device_SendByte(&VirtualSerial_CDC_Interface, cmdChar);
-                  switch (cmdChar)
-                  {
-                     case '\r':
-                     case '\n':
-                        break;
-                     case '?':   // 'manpage'
-                        cliState = CLI_HELP;
-                        break;
-                     case 'i':   // return bitstream header info from FLASH
-                        cliState = CLI_FLASH_INFO;
-                        break;
-                     case 'V':   // feed bitstream volatile into FPGA
-                        cfgSrc = CFG_SRC_USB;
-                        p(needStr);
-                        cliState = CLI_XILINX_TRIGGER_CONFIG;
-                        break;
-                     case 'C':   // configure from recent SPI-FLASH content
-                        cfgSrc = CFG_SRC_SPI;
-                        p(PSTR("\r\n"));
-                        cliState = CLI_XILINX_TRIGGER_CONFIG;
-                        break;
-                     case 'W':   // store bitstream non-volatile into SPI-FLASH
-                        eraseFlash();
-                        p(needStr);
-                        flashAddr = 0;
-                        fileSize = 0;
-                        cliState = CLI_STORE_BITSTREAM_INTRO;
-                        break;
-/*
-                     case 'v':   // verify FLASH data
-                        p(needStr);
-                        flashAddr = 0;
-                        cliState = CLI_VERIFY_FLASH;
-                        break;
-*/
-                     case 'E':   // erase FLASH
-                        eraseFlash();
-                        break;
-                     default:
-                        p(unknownStr);
-                  }
+                  // Free the EP as fast as possible for the next USB packet
+                  // to drop in in the background. Hope this is how LUFA
+                  // works otherwise this is waste.
+                  uint16_t rxCount = CDC_Device_BytesReceived(&CONSOLE_INTERFACE);
+                  for (uint16_t n = 0; n < rxCount; n++)
+                     aBuffer[flashAddr++] = CDC_Device_ReceiveByte(&CONSOLE_INTERFACE);
                }
-               else
-                  for (uint8_t n = rxCount; n > 0; n--)
-                     CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
+               break;
+            case CFG_SRC_SPI:
+               {
+                  // Get as many bytes from FLASH as possible.
+                  readFlash(aBuffer, flashAddr, sizeof(aBuffer));
+                  flashAddr += sizeof(aBuffer);
+               }
+               break;
+            default:
+               cliState = CLI_PROMPT;
+         }
+         if (flashAddr > (sizeof(aBuffer) - CDC_TXRX_EPSIZE))
+         {
+            uint8_t* ptrToSize = (uint8_t*)XilinxGetHeaderField(aBuffer, XILINX_FIELD_DATA);
+            if (ptrToSize != 0)
+            {
+               fileSize = XilinxExtractBitstreamSize(ptrToSize);
+               uint8_t* ptrToData = ptrToSize + XILINX_SIZE_OF_SIZE;
+               uint16_t remaining = (uint16_t)(aBuffer + flashAddr - ptrToData );
+               fileSize -= remaining;
+               XilinxReset();
+               XilinxWriteBlock(ptrToData, remaining);
+               cliState = CLI_XILINX_CONFIGURE_BODY;
             }
-            break;
-         case CLI_XILINX_TRIGGER_CONFIG:
-            flashAddr = 0;
-            fileSize = 0;
-            cliState = CLI_XILINX_CONFIGURE_INTRO;
-            // There is intentionally no `break;` here!
-         case CLI_XILINX_CONFIGURE_INTRO:
-            switch (cfgSrc)
+            else
             {
-               case CFG_SRC_USB:
-                  {
-                     // Free the EP as fast as possible for the next USB packet
-                     // to drop in in the background. Hope this is how LUFA
-                     // works otherwise this is waste.
-                     uint16_t rxCount = CDC_Device_BytesReceived(&VirtualSerial_CDC_Interface);
-                     for (uint16_t n = 0; n < rxCount; n++)
-                        aBuffer[flashAddr++] = CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
-                  }
-                  break;
-               case CFG_SRC_SPI:
-                  {
-                     // Get as many bytes from FLASH as possible.
-                     readFlash(aBuffer, flashAddr, sizeof(aBuffer));
-                     flashAddr += sizeof(aBuffer);
-                  }
-                  break;
-               default:
-                  cliState = CLI_PROMPT;
+               p(invalidStr);
+               cliState = CLI_PROMPT;
+            }
+         }
+         break;
+      case CLI_XILINX_CONFIGURE_BODY: ;
+         {
+            uint16_t rxCount = 0;
+            if (cfgSrc == CFG_SRC_USB)
+            {
+               rxCount = CDC_Device_BytesReceived(&CONSOLE_INTERFACE);
+               for (uint16_t n = 0; n < rxCount; n++)
+                  aBuffer[n] = CDC_Device_ReceiveByte(&CONSOLE_INTERFACE);
+            }
+            else // CFG_SRC_SPI
+            {
+               rxCount = sizeof(aBuffer);
+               readFlash(aBuffer, flashAddr, rxCount);
+               flashAddr += rxCount;
+            }
+            if (fileSize < (uint32_t)rxCount)
+            {
+               rxCount = (uint16_t)fileSize;
+               fileSize = 0;
+            }
+            else
+               fileSize -= rxCount;
+            XilinxWriteBlock(aBuffer, rxCount);
+            if (fileSize == 0)
+               cliState = CLI_XILINX_FINISH;
+         }
+         break;
+      case CLI_XILINX_FINISH:
+         {
+            if (XilinxFinishConfig() == XILINX_CFG_SUCCESS)
+            {
+               p(successStr);
+#if defined(AUTORUN_MACRO)
+               ucifBaseInit();
+               macroRun(AUTORUN_MACRO);
+#endif
+               cliState = CLI_PROMPT;  // for the console running on
+               return(1);
+            }
+            else
+            {
+               p(failStr);
+               cliState = CLI_PROMPT;
             }
+         }
+         break;
+      case CLI_STORE_BITSTREAM_INTRO: ;
+         {
+            uint16_t rxCount = CDC_Device_BytesReceived(&CONSOLE_INTERFACE);
+            for (uint16_t n = 0; n < rxCount; n++)
+               aBuffer[flashAddr++] = CDC_Device_ReceiveByte(&CONSOLE_INTERFACE);
             if (flashAddr > (sizeof(aBuffer) - CDC_TXRX_EPSIZE))
             {
                uint8_t* ptrToSize = (uint8_t*)XilinxGetHeaderField(aBuffer, XILINX_FIELD_DATA);
                if (ptrToSize != 0)
                {
                   fileSize = XilinxExtractBitstreamSize(ptrToSize);
-                  uint8_t* ptrToData = ptrToSize + XILINX_SIZE_OF_SIZE;
-                  uint16_t remaining = (uint16_t)(aBuffer + flashAddr - ptrToData );
-                  fileSize -= remaining;
-                  XilinxReset();
-                  XilinxWriteBlock(ptrToData, remaining);
-                  cliState = CLI_XILINX_CONFIGURE_BODY;
+                  fileSize += (uint32_t)(ptrToSize - aBuffer);
+                  writeFlash(aBuffer, 0, (uint16_t) flashAddr);
+                  cliState = CLI_STORE_BITSTREAM_BODY;
                }
                else
                {
@@ -493,116 +2233,213 @@ void commandLineInterface(void)
                   cliState = CLI_PROMPT;
                }
             }
-            break;
-         case CLI_XILINX_CONFIGURE_BODY: ;
-            {
-               uint16_t rxCount = 0;
-               if (cfgSrc == CFG_SRC_USB)
-               {
-                  rxCount = CDC_Device_BytesReceived(&VirtualSerial_CDC_Interface);
-                  for (uint16_t n = 0; n < rxCount; n++)
-                     aBuffer[n] = CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
-               }
-               else // CFG_SRC_SPI
-               {
-                  rxCount = sizeof(aBuffer);
-                  readFlash(aBuffer, flashAddr, rxCount);
-                  flashAddr += rxCount;
-               }
-               if (fileSize < (uint32_t)rxCount)
-               {
-                  rxCount = (uint16_t)fileSize;
-                  fileSize = 0;
-               }
-               else
-                  fileSize -= rxCount;
-               XilinxWriteBlock(aBuffer, rxCount);
-               if (fileSize == 0)
-                  cliState = CLI_XILINX_FINISH;
-            }
-            break;
-         case CLI_XILINX_FINISH:
-            {
-               if (XilinxFinishConfig() == XILINX_CFG_SUCCESS)
-               {
-                  p(successStr);
-                  return;  // it is time to start the user application code
-               }
-               else
-               {
-                  p(failStr);
-                  cliState = CLI_PROMPT;
-               }
-            }
-            break;
-         case CLI_STORE_BITSTREAM_INTRO: ;
+         }
+         break;
+      case CLI_STORE_BITSTREAM_BODY: ;
+         {
+            uint16_t rxCount = CDC_Device_BytesReceived(&CONSOLE_INTERFACE);
+            if (rxCount > 0)
             {
-               uint16_t rxCount = CDC_Device_BytesReceived(&VirtualSerial_CDC_Interface);
                for (uint16_t n = 0; n < rxCount; n++)
-                  aBuffer[flashAddr++] = CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
-               if (flashAddr > (sizeof(aBuffer) - CDC_TXRX_EPSIZE))
-               {
-                  uint8_t* ptrToSize = (uint8_t*)XilinxGetHeaderField(aBuffer, XILINX_FIELD_DATA);
-                  if (ptrToSize != 0)
-                  {
-                     fileSize = XilinxExtractBitstreamSize(ptrToSize);
-                     fileSize += (uint32_t)(ptrToSize - aBuffer);
-                     writeFlash(aBuffer, 0, (uint16_t) flashAddr);
-                     cliState = CLI_STORE_BITSTREAM_BODY;
-                  }
-                  else
-                  {
-                     p(invalidStr);
-                     cliState = CLI_PROMPT;
-                  }
-               }
+                  aBuffer[n] = CDC_Device_ReceiveByte(&CONSOLE_INTERFACE);
+               writeFlash(aBuffer, flashAddr, rxCount);
+               flashAddr += rxCount;
             }
-            break;
-         case CLI_STORE_BITSTREAM_BODY: ;
+            if (flashAddr >= fileSize)
             {
-               uint16_t rxCount = CDC_Device_BytesReceived(&VirtualSerial_CDC_Interface);
-               if (rxCount > 0)
-               {
-                  for (uint16_t n = 0; n < rxCount; n++)
-                     aBuffer[n] = CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
-                  writeFlash(aBuffer, flashAddr, rxCount);
-                  flashAddr += rxCount;
-               }
-               if (flashAddr >= fileSize)
-               {
-                  cfgSrc = CFG_SRC_SPI;
-                  cliState = CLI_XILINX_TRIGGER_CONFIG;
-               }
+#if defined(MSC_DRIVE)
+               mscScanFlash();
+#endif
+               cfgSrc = CFG_SRC_SPI;
+               cliState = CLI_XILINX_TRIGGER_CONFIG;
             }
-            break;
+         }
+         break;
 /*
-         case CLI_VERIFY_FLASH:
+      case CLI_VERIFY_FLASH:
+         {
+            uint8_t  flBuffer[CDC_TXRX_EPSIZE];
+            uint16_t rxCount = CDC_Device_BytesReceived(&CONSOLE_INTERFACE);
+            if (rxCount > 0)
             {
-               uint8_t  flBuffer[CDC_TXRX_EPSIZE];
-               uint16_t rxCount = CDC_Device_BytesReceived(&VirtualSerial_CDC_Interface);
-               if (rxCount > 0)
+               for (uint16_t n = 0; n < rxCount; n++)
+                  aBuffer[n] = CDC_Device_ReceiveByte(&CONSOLE_INTERFACE);
+               readFlash(flBuffer, flashAddr, rxCount);
+               flashAddr += rxCount;
+               for (uint16_t n = 0; n < rxCount; n++)
                {
-                  for (uint16_t n = 0; n < rxCount; n++)
-                     aBuffer[n] = CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
-                  readFlash(flBuffer, flashAddr, rxCount);
-                  flashAddr += rxCount;
-                  for (uint16_t n = 0; n < rxCount; n++)
+                  if (aBuffer[n] != flBuffer[n])
                   {
-                     if (aBuffer[n] != flBuffer[n])
-                     {
-                        p(unequalStr);
-                        cliState = CLI_PROMPT;
-                     }
+                     p(unequalStr);
+                     cliState = CLI_PROMPT;
                   }
                }
             }
-            break;
+         }
+         break;
 */
-         default:
-            ;
+      default:
+         ;
+   }
+   return(0);
+}
+
+
+#if defined(STARTUP_TIMING)
+void startupStamp(uint8_t stamp)
+{
+   uint8_t mask = (1 << stamp);
+
+   if (startupTaken & mask)
+      return;
+   // An overflow means the time stamp is out of range.
+   startupTicks[stamp] = (TIFR1 & (1 << TOV1)) ? 0xFFFF : TCNT1;
+   startupTaken |= mask;
+   if (stamp == STARTUP_FIRST_BYTE)
+      TCCR1B = 0;
+}
+
+
+void startupReport(void)
+{
+   const char *label[STARTUP_STAMPS] = { startupStr, configStr, firstStr };
+   char str[11];
+
+   for (uint8_t n = 0; n < STARTUP_STAMPS; n++)
+   {
+      p(label[n]);
+      if (!(startupTaken & (1 << n)))
+         p(PSTR("-"));
+      else if (startupTicks[n] == 0xFFFF)
+         p(PSTR("overflow"));
+      else
+      {
+         // One tick is 1024/F_CPU, the result is in units of 0.1 ms.
+         uint32_t tenths = ((uint32_t)startupTicks[n] * 10240UL) / (F_CPU / 1000UL);
+
+         fputs(ultoa(tenths / 10, str, 10), &USBSerialStream);
+         CDC_Device_SendByte(&CONSOLE_INTERFACE, '.');
+         CDC_Device_SendByte(&CONSOLE_INTERFACE, '0' + (tenths % 10));
       }
    }
 }
+#endif
+
+
+#if defined(UCIF_BENCHMARK)
+/**
+ *  \~English
+ *   Restarts Timer1 counting CPU cycles.
+ *
+ *  \~German
+ *   Startet Timer1 neu, er zhlt CPU-Takte.
+ */
+static inline void benchStart(void)
+{
+   TCCR1B = 0;
+   TCNT1  = 0;
+   TCCR1B = (1 << CS10);
+}
+
+
+/**
+ *  \~English
+ *   Stops Timer1.
+ *   @return CPU cycles since benchStart().
+ *
+ *  \~German
+ *   Hlt Timer1 an.
+ *   @return CPU-Takte seit benchStart().
+ */
+static inline uint16_t benchStop(void)
+{
+   TCCR1B = 0;
+   return(TCNT1);
+}
+
+
+void ucifBenchmark(const uint8_t writes)
+{
+   const char *label[BENCH_KERNELS] = { sdrWrStr, sdrRdStr, ddrWrStr, ddrRdStr };
+   uint16_t cycles[BENCH_KERNELS];
+   uint16_t overhead;
+   volatile uint8_t sink;
+   uint8_t timerControl = TCCR1B;
+   uint16_t timerCount = TCNT1;
+   char str[11];
+
+   // Interrupts stay disabled for one kernel run at a time only, about
+   // 0.5 ms, the USB gets served in between.
+   memset(aBuffer, 0, 2 * BENCH_WORDS);
+   // An empty call measures the cost of the call and of Timer1 handling.
+   GlobalInterruptDisable();
+   benchStart();
+   ucifKernelWrite(aBuffer, 0);
+   overhead = benchStop();
+   GlobalInterruptEnable();
+
+   // The reads address register 0, so do the DDR reads following them.
+   UCIF_DDR_CLR;
+   UCIF_AS_INPUT;
+   UCIF_RW_SET;
+   GlobalInterruptDisable();
+   benchStart();
+   ucifKernelSdrRead(aBuffer, BENCH_WORDS, &sink);
+   cycles[1] = benchStop();
+   GlobalInterruptEnable();
+
+   UCIF_DDR_SET;
+   GlobalInterruptDisable();
+   benchStart();
+   ucifKernelDdrRead(BENCH_WORDS, &sink);
+   cycles[3] = benchStop();
+   GlobalInterruptEnable();
+
+   if (writes)
+   {
+      // The writes store the content of register 0 back into it.
+      uint8_t content = ucifRead(0);
+
+      for (uint8_t n = 0; n < BENCH_WORDS; n++)
+         aBuffer[2 * n + 1] = content;
+      UCIF_RW_CLR;
+      UCIF_AS_OUTPUT;
+      GlobalInterruptDisable();
+      benchStart();
+      ucifKernelWrite(aBuffer, BENCH_WORDS);
+      cycles[0] = benchStop();
+      GlobalInterruptEnable();
+
+      memset(aBuffer, content, 2 * BENCH_WORDS);
+      UCIF_DDR_SET;
+      GlobalInterruptDisable();
+      benchStart();
+      ucifKernelWrite(aBuffer, BENCH_WORDS);
+      cycles[2] = benchStop();
+      GlobalInterruptEnable();
+   }
+
+   UCIF_DDR_CLR;
+   TCNT1 = timerCount;
+   TCCR1B = timerControl;
+
+   p(benchStr);
+   // Without the writes just the odd entries got measured.
+   for (uint8_t n = writes ? 0 : 1; n < BENCH_KERNELS; n += writes ? 1 : 2)
+   {
+      uint16_t net = cycles[n] - overhead;
+      // Each word moves two bytes across the bus, an SDR-RD the address
+      // and the data.
+      uint32_t rate = (F_CPU / net) * (2 * BENCH_WORDS) +
+                      ((F_CPU % net) * (2 * BENCH_WORDS)) / net;
+
+      p(label[n]);
+      fputs(utoa(net, str, 10), &USBSerialStream);
+      CDC_Device_SendByte(&CONSOLE_INTERFACE, ' ');
+      fputs(ultoa(rate, str, 10), &USBSerialStream);
+   }
+}
+#endif
 
 
 void EVENT_USB_Device_Connect(void)
@@ -620,13 +2457,96 @@ void EVENT_USB_Device_ConfigurationChanged(void)
    bool ConfigSuccess = true;
 
    ConfigSuccess &= CDC_Device_ConfigureEndpoints(&VirtualSerial_CDC_Interface);
+#if defined(DUAL_CDC)
+   ConfigSuccess &= CDC_Device_ConfigureEndpoints(&Console_CDC_Interface);
+#endif
+#if defined(HID_LINK)
+   ConfigSuccess &= HID_Device_ConfigureEndpoints(&UCIF_HID_Interface);
+#endif
+#if defined(MSC_DRIVE)
+   ConfigSuccess &= MS_Device_ConfigureEndpoints(&Flash_MS_Interface);
+#endif
+
+   USB_Device_EnableSOFEvents();
+#if defined(STARTUP_TIMING)
+   startupStamp(STARTUP_CONFIGURED);
+#endif
 }
 
 
 void EVENT_USB_Device_ControlRequest(void)
 {
    CDC_Device_ProcessControlRequest(&VirtualSerial_CDC_Interface);
+#if defined(DUAL_CDC)
+   CDC_Device_ProcessControlRequest(&Console_CDC_Interface);
+#endif
+#if defined(HID_LINK)
+   HID_Device_ProcessControlRequest(&UCIF_HID_Interface);
+#endif
+#if defined(MSC_DRIVE)
+   MS_Device_ProcessControlRequest(&Flash_MS_Interface);
+#endif
+}
+
+
+void EVENT_USB_Device_StartOfFrame(void)
+{
+   frameCount++;
+}
+
+
+ISR(TIMER3_COMPA_vect)
+{
+   // A sample not fitting into the buffer gets dropped, the gap in the
+   // sequence numbers tells the host.
+   if (ringFree(&sampleRing) > sampleCount)
+   {
+      ringInsert(&sampleRing, sampleSeq);
+      for (uint8_t n = 0; n < sampleCount; n++)
+         ringInsert(&sampleRing, ucifRead(sampleRegs[n]));
+   }
+   sampleSeq++;
+}
+
+
+#if defined(ATTENTION_EVENTS)
+ISR(INT6_vect)
+{
+   attention = 1;
+}
+#endif
+
+
+#if defined(HID_LINK)
+bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+                                         uint8_t* const ReportID,
+                                         const uint8_t ReportType,
+                                         void* ReportData,
+                                         uint16_t* const ReportSize)
+{
+   if (!hidAnswerPending)
+      return false;  // *ReportSize stays 0, nothing gets sent
+   memcpy(ReportData, hidAnswer, HID_REPORT_SIZE);
+   *ReportSize = HID_REPORT_SIZE;
+   hidAnswerPending = 0;
+   return true;
+}
+
+
+void CALLBACK_HID_Device_ProcessHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+                                          const uint8_t ReportID,
+                                          const uint8_t ReportType,
+                                          const void* ReportData,
+                                          const uint16_t ReportSize)
+{
+   // Just one transaction at a time, the host has to await the answer.
+   if (hidRequestPending || (ReportType != HID_REPORT_ITEM_Out))
+      return;
+   memset(hidRequest, 0, sizeof(hidRequest));
+   memcpy(hidRequest, ReportData, (ReportSize > HID_REPORT_SIZE) ? HID_REPORT_SIZE : ReportSize);
+   hidRequestPending = 1;
 }
+#endif
 
 
 void EVENT_CDC_Device_ControLineStateChanged(USB_ClassInfo_CDC_Device_t *const CDCInterfaceInfo)
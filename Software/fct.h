@@ -39,6 +39,7 @@
 
    #include <avr/io.h>
    #include "Descriptors.h"
+   #include "./Ring/ring.h"
 
 
    // Function Prototypes:
@@ -106,6 +107,38 @@
     */
 
 
+   uint8_t commandLineTask(void);
+   /**<
+    * \~English
+    *  Performs one step of the command line. The 'commandLineInterface' calls
+    *  it in its loop. With DUAL_CDC the 'applicationLoop' calls it too, so the
+    *  console keeps responding while the FPGA application is running.
+    *  @return 1 when the FPGA just got configured successfully, 0 otherwise.
+    *
+    * \~German
+    *  Führt einen Schritt der Kommandozeile aus. Das 'commandLineInterface'
+    *  ruft die Funktion in seiner Schleife auf. Mit DUAL_CDC ruft auch die
+    *  'applicationLoop' sie auf, die Konsole bleibt so auch während der
+    *  FPGA-Anwendung bedienbar.
+    *  @return 1 wenn das FPGA soeben erfolgreich konfiguriert wurde, sonst 0.
+    */
+
+
+   uint8_t commandLineBusy(void);
+   /**<
+    * \~English
+    *  Tells whether the command line is processing a bitstream (FPGA
+    *  configuration or FLASH write). The UCIF must not be used then.
+    *  @return !'0' (true) while a bitstream is processed.
+    *
+    * \~German
+    *  Zeigt an, ob die Kommandozeile einen Bitstream verarbeitet
+    *  (FPGA-Konfiguration oder FLASH schreiben). Das UCIF darf dann nicht
+    *  benutzt werden.
+    *  @return !'0' (true) solange ein Bitstream verarbeitet wird.
+    */
+
+
    void applicationLoop(void);
    /**<
     * \~English
@@ -122,6 +155,259 @@
     */
 
 
+#if defined(STARTUP_TIMING)
+   void startupStamp(uint8_t stamp);
+   /**<
+    * \~English
+    *  Takes the time stamp 'stamp' (STARTUP_USB_INIT, STARTUP_CONFIGURED or
+    *  STARTUP_FIRST_BYTE) from Timer1 once, later calls are ignored. The
+    *  last one stops Timer1.
+    *
+    * \~German
+    *  Nimmt den Zeitstempel 'stamp' (STARTUP_USB_INIT, STARTUP_CONFIGURED
+    *  oder STARTUP_FIRST_BYTE) einmalig von Timer1, weitere Aufrufe werden
+    *  ignoriert. Der letzte hält Timer1 an.
+    */
+
+
+   void startupReport(void);
+   /**<
+    * \~English
+    *  Sends the startup time stamps in ms to the console.
+    *
+    * \~German
+    *  Sendet die Zeitstempel des Starts in ms an die Konsole.
+    */
+#endif
+
+
+#if defined(UCIF_BENCHMARK)
+   void ucifBenchmark(const uint8_t writes);
+   /**<
+    * \~English
+    *  Runs the UCIF read kernels (SDR-RD, DDR-RD) and with 'writes' !'0'
+    *  the write kernels (SDR-WR, DDR-WR) too for 255 words each, Timer1
+    *  counting CPU cycles. Interrupts get disabled for one kernel run at a
+    *  time only. Sends the cycles, the call overhead taken off, and the
+    *  resulting bus bytes per second to the console. Timer1 gets restored
+    *  afterwards, it just misses the cycles of the benchmark.
+    *  @note All accesses go to register 0 of the FPGA design, the writes
+    *  store its content read before back into it. Meant for an idle data
+    *  channel.
+    *
+    * \~German
+    *  Führt die UCIF-Lesekerne (SDR-RD, DDR-RD) und mit 'writes' !'0' auch
+    *  die Schreibkerne (SDR-WR, DDR-WR) für je 255 Worte aus, Timer1 zählt
+    *  die CPU-Takte. Die Interrupts werden nur für jeweils einen Kernlauf
+    *  gesperrt. Sendet die Takte abzüglich des Aufrufaufwands und die
+    *  daraus folgenden Busbytes pro Sekunde an die Konsole. Timer1 wird
+    *  danach wiederhergestellt, ihm fehlen nur die Takte des Tests.
+    *  @note Alle Zugriffe gehen auf das Register 0 des FPGA-Designs, die
+    *  Schreibzugriffe schreiben seinen zuvor gelesenen Inhalt zurück.
+    *  Gedacht für einen ruhenden Datenkanal.
+    */
+#endif
+
+
+   uint8_t cdcReceive(ring_t *const ring);
+   /**<
+    * \~English
+    *  Moves the bytes received by the data CDC function from the OUT
+    *  endpoint into 'ring'. The endpoint gets selected once and the bytes
+    *  are copied into the contiguous free block of the ring, what does not
+    *  fit stays in the endpoint for the next call.
+    *  @return Count of bytes moved.
+    *
+    * \~German
+    *  Überträgt die von der Daten-CDC-Funktion empfangenen Bytes aus dem
+    *  OUT-Endpunkt in 'ring'. Der Endpunkt wird einmal ausgewählt und die
+    *  Bytes werden in den zusammenhängenden freien Abschnitt des
+    *  Ringpuffers kopiert, was nicht passt verbleibt für den nächsten Aufruf
+    *  im Endpunkt.
+    *  @return Anzahl der übertragenen Bytes.
+    */
+
+
+   void ucifPollStart(uint8_t address, uint8_t mask, uint8_t value, uint8_t interval, uint8_t timeout);
+   /**<
+    * \~English
+    *  Prepares polling register 'address' until ('data' & 'mask') == 'value'
+    *  or 'timeout' ms have passed, waiting at least 'interval' µs between
+    *  the reads (rounded up to the Timer1 resolution). Timer1 gets saved and
+    *  restarted, ucifPollStep() does the reads.
+    *
+    * \~German
+    *  Bereitet das Abfragen des Registers 'address' vor, bis ('data' &
+    *  'mask') == 'value' gilt oder 'timeout' ms vergangen sind, mit
+    *  mindestens 'interval' µs zwischen den Zugriffen (aufgerundet auf die
+    *  Auflösung von Timer1). Timer1 wird gesichert und neu gestartet,
+    *  ucifPollStep() führt die Zugriffe aus.
+    */
+
+
+   uint8_t ucifPollStep(void);
+   /**<
+    * \~English
+    *  Reads the register polled if due and returns at once otherwise, so
+    *  the application loop keeps serving USB in between. When the condition
+    *  is met or the timeout has passed, Timer1 gets restored and the last
+    *  value read, 1 if the condition was met (0 otherwise) and the elapsed
+    *  µs up to the last read (3 bytes, least significant byte first) get
+    *  sent to the host.
+    *  @return !'0' (true) when polling is done.
+    *
+    * \~German
+    *  Liest das abgefragte Register bei Fälligkeit und kehrt sonst sofort
+    *  zurück, die Anwendungsschleife bedient also weiterhin den USB. Ist
+    *  die Bedingung erfüllt oder die Zeit abgelaufen, wird Timer1
+    *  wiederhergestellt und der zuletzt gelesene Wert, 1 wenn die Bedingung
+    *  erfüllt wurde (sonst 0) und die bis zum letzten Zugriff vergangenen
+    *  µs (3 Bytes, das niederwertigste zuerst) werden an den Host gesendet.
+    *  @return !'0' (true) wenn die Abfrage beendet ist.
+    */
+
+
+   void cdcSendAck(uint16_t packets, uint32_t bytes, uint8_t flags);
+   /**<
+    * \~English
+    *  Sends the cumulative write ack to the host: 'a' 7, the count of write
+    *  packets (16 bit), the count of write data bytes (32 bit), both least
+    *  significant byte first, and the error flags.
+    *
+    * \~German
+    *  Sendet die Sammelquittung für Schreibpakete an den Host: 'a' 7, die
+    *  Anzahl der Schreibpakete (16 Bit), die Anzahl der geschriebenen
+    *  Datenbytes (32 Bit), beide mit dem niederwertigsten Byte zuerst, und
+    *  die Fehlerflags.
+    */
+
+
+   uint8_t cdcWriteThrough(ring_t *const ring, uint8_t words);
+   /**<
+    * \~English
+    *  Strobes the payload of a write packet straight from the OUT endpoint
+    *  of the data CDC function to the UCIF, there is no copy into RAM. Call
+    *  it with the UCIF set up for writing and 'ring' empty only, the ring
+    *  is just used for a word split between two USB packets.
+    *  @return Count of words still to write.
+    *
+    * \~German
+    *  Schreibt die Nutzdaten eines Schreibpakets direkt aus dem OUT-Endpunkt
+    *  der Daten-CDC-Funktion auf das UCIF, ohne Kopie ins RAM. Der Aufruf
+    *  erfolgt nur mit für Schreibzugriffe vorbereitetem UCIF und leerem
+    *  'ring', der Ringpuffer nimmt nur ein auf zwei USB-Pakete verteiltes
+    *  Wort auf.
+    *  @return Anzahl der noch zu schreibenden Worte.
+    */
+
+
+   void cdcSendSDR(const uint8_t *address, uint8_t count);
+   /**<
+    * \~English
+    *  Performs 'count' SDR read accesses to the UCIF, one per address given.
+    *  The bytes read go straight into the IN endpoint of the data CDC
+    *  function, it gets selected just once for the whole block.
+    *
+    * \~German
+    *  Führt 'count' SDR-Lesezugriffe auf das UCIF aus, einen je übergebener
+    *  Adresse. Die gelesenen Bytes gehen direkt in den IN-Endpunkt der
+    *  Daten-CDC-Funktion, der für den ganzen Block nur einmal ausgewählt
+    *  wird.
+    */
+
+
+   void cdcSendBurst(uint8_t address, uint8_t count);
+   /**<
+    * \~English
+    *  Performs 'count' SDR read accesses to the UCIF, starting at 'address'
+    *  and incrementing it for each access. The bytes read go straight into
+    *  the IN endpoint of the data CDC function.
+    *
+    * \~German
+    *  Führt 'count' SDR-Lesezugriffe auf das UCIF aus, beginnend bei
+    *  'address' und mit jedem Zugriff um eins erhöht. Die gelesenen Bytes
+    *  gehen direkt in den IN-Endpunkt der Daten-CDC-Funktion.
+    */
+
+
+   void cdcSendDDR(uint8_t words);
+   /**<
+    * \~English
+    *  Performs 'words' DDR read accesses to the UCIF set up for reading. The
+    *  bytes read go straight into the IN endpoint of the data CDC function,
+    *  it gets selected just once for the whole block.
+    *
+    * \~German
+    *  Führt 'words' DDR-Lesezugriffe auf das für Lesezugriffe vorbereitete
+    *  UCIF aus. Die gelesenen Bytes gehen direkt in den IN-Endpunkt der
+    *  Daten-CDC-Funktion, der für den ganzen Block nur einmal ausgewählt
+    *  wird.
+    */
+
+
+#if defined(HID_LINK)
+   void hidTransaction(void);
+   /**<
+    * \~English
+    *  Performs the UCIF accesses of the pending HID request and prepares the
+    *  answer report. Supported are SDR-WR ('w', up to 31 words) and SDR-RD
+    *  ('r', up to 62 bytes), both with the packet layout of the application
+    *  interface. The answer echoes ID and (clipped) length, followed by the
+    *  data read. Any other ID is answered with a length of 0.
+    *  The 'applicationLoop' calls it once per pass, except during DDR
+    *  transfers and an in-session configuration of the data CDC function.
+    *
+    * \~German
+    *  Führt die UCIF-Zugriffe der anstehenden HID-Anfrage aus und bereitet
+    *  den Antwort-Report vor. Unterstützt werden SDR-WR ('w', bis zu 31
+    *  Worte) und SDR-RD ('r', bis zu 62 Bytes), beide mit dem Paketaufbau
+    *  der Anwendungsschnittstelle. Die Antwort wiederholt ID und (begrenzte)
+    *  Länge, danach folgen die gelesenen Daten. Jede andere ID wird mit der
+    *  Länge 0 beantwortet.
+    *  Die 'applicationLoop' ruft die Funktion einmal je Durchlauf auf,
+    *  außer während DDR-Übertragungen und einer Konfiguration während der
+    *  Sitzung auf der Daten-CDC-Funktion.
+    */
+
+
+   bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+                                            uint8_t* const ReportID,
+                                            const uint8_t ReportType,
+                                            void* ReportData,
+                                            uint16_t* const ReportSize);
+   /**<
+    * \~English
+    *  HID class driver callback to fill the next IN report. It hands over a
+    *  pending answer of 'hidTransaction', otherwise no report is sent.
+    *
+    * \~German
+    *  Funktion des HID-Klassentreibers zum Füllen des nächsten IN-Reports.
+    *  Sie übergibt eine anstehende Antwort von 'hidTransaction', sonst wird
+    *  kein Report gesendet.
+    */
+
+
+   void CALLBACK_HID_Device_ProcessHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
+                                             const uint8_t ReportID,
+                                             const uint8_t ReportType,
+                                             const void* ReportData,
+                                             const uint16_t ReportSize);
+   /**<
+    * \~English
+    *  HID class driver callback for a report received by SET_REPORT. It runs
+    *  in the USB interrupt, so the request is just stored for the
+    *  'applicationLoop'. Requests arriving while another one is pending get
+    *  dropped.
+    *
+    * \~German
+    *  Funktion des HID-Klassentreibers für einen per SET_REPORT empfangenen
+    *  Report. Sie läuft im USB-Interrupt, die Anfrage wird daher nur für die
+    *  'applicationLoop' abgelegt. Anfragen, die eintreffen während noch eine
+    *  andere ansteht, werden verworfen.
+    */
+#endif
+
+
    void EVENT_USB_Device_Connect(void);
    /**<
     * \~English
@@ -162,6 +448,19 @@
     */
 
 
+   void EVENT_USB_Device_StartOfFrame(void);
+   /**<
+    * \~English
+    *  Event handler for the library USB Start Of Frame event. Counts the
+    *  frames, the application loop uses it as its flush timer.
+    *
+    * \~German
+    *  Ereignisverarbeitung der Laufzeitbibliothek für USB Start Of Frame.
+    *  Zählt die Frames, die Anwendungsschleife nutzt dies als Zeitgeber für
+    *  das Absenden der Antworten.
+    */
+
+
    void EVENT_CDC_Device_ControLineStateChanged(USB_ClassInfo_CDC_Device_t *const CDCInterfaceInfo);
    /**<
     * \~English